@@ -7,7 +7,7 @@
 * Author Rob Jennings
 */
 
-const uint8_t Font4x5FixedBitmaps[] PROGMEM = {
+constexpr uint8_t Font4x5FixedBitmaps[] PROGMEM = {
   0xE8, 0xA0, 0x5F, 0x5F, 0x50, 0xFA, 0xF5, 0xF0, 0xA5, 0x4A, 0x00, 0xEA,
   0xFA, 0xF0, 0x80, 0x6A, 0x40, 0x95, 0x80, 0xAA, 0x80, 0x5D, 0x00, 0xC0,
   0xE0, 0x80, 0x12, 0x48, 0x76, 0xDC, 0x00, 0xF8, 0xE7, 0xCE, 0x00, 0xE5,
@@ -29,7 +29,7 @@ const uint8_t Font4x5FixedBitmaps[] PROGMEM = {
   0x22, 0x00, 0xF8, 0x89, 0xA8, 0xCC, 0x00
 };
 
-const GFXglyph Font4x5FixedGlyphs[] PROGMEM = {
+constexpr GFXglyph Font4x5FixedGlyphs[] PROGMEM = {
   {     0,   0,   0,   2,    0,    1 }   // ' '
  ,{     0,   1,   5,   2,    0,   -4 }   // '!'
  ,{     1,   3,   1,   4,    0,   -4 }   // '"'
@@ -127,7 +127,7 @@ const GFXglyph Font4x5FixedGlyphs[] PROGMEM = {
  ,{   221,   3,   2,   4,    0,   -2 }   // '~'
 };
 
-const GFXfont Font4x5Fixed PROGMEM = {
+constexpr GFXfont Font4x5Fixed PROGMEM = {
   (uint8_t  *)Font4x5FixedBitmaps,
   (GFXglyph *)Font4x5FixedGlyphs,
   0x20, 0x7E, 5 };
\ No newline at end of file
@@ -7,7 +7,7 @@
 *
 * Author Rob Jennings
 */
-const uint8_t Font4x7FixedBitmaps[] PROGMEM = {
+constexpr uint8_t Font4x7FixedBitmaps[] PROGMEM = {
   0xFA, 0xB4, 0x55, 0xF5, 0xF5, 0x50, 0x5F, 0x77, 0xD0, 0x00, 0x94, 0xA9,
   0x48, 0x00, 0x4A, 0xA5, 0xAB, 0x60, 0xD8, 0x00, 0x6A, 0xA4, 0x00, 0x95,
   0x58, 0x00, 0xAA, 0x80, 0x5D, 0x00, 0xD0, 0xE0, 0xF0, 0x25, 0x25, 0x20,
@@ -36,7 +36,7 @@ const uint8_t Font4x7FixedBitmaps[] PROGMEM = {
   0x88, 0x00, 0xFE, 0x00, 0x89, 0x14, 0xA0, 0x00, 0xCC, 0x00
 };
 
-const GFXglyph Font4x7FixedGlyphs[] PROGMEM = {
+constexpr GFXglyph Font4x7FixedGlyphs[] PROGMEM = {
   {     0,   0,   1,   2,    0,    0 }   // ' '
  ,{     0,   1,   7,   2,    0,   -7 }   // '!'
  ,{     1,   3,   2,   4,    0,   -7 }   // '"'
@@ -134,7 +134,7 @@ const GFXglyph Font4x7FixedGlyphs[] PROGMEM = {
  ,{   308,   3,   2,   4,    0,   -4 }   // '~'
 };
 
-const GFXfont Font4x7Fixed PROGMEM = {
+constexpr GFXfont Font4x7Fixed PROGMEM = {
 (uint8_t  *)Font4x7FixedBitmaps,
 (GFXglyph *)Font4x7FixedGlyphs,
 0x20, 0x7E, 7};
\ No newline at end of file
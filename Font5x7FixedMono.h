@@ -8,7 +8,7 @@
 * Author Rob Jennings
 */
 
-const uint8_t FixedMono5x7Bitmaps[] PROGMEM = {
+constexpr uint8_t FixedMono5x7Bitmaps[] PROGMEM = {
   0xFA, 0xB4, 0x52, 0xBE, 0xAF, 0xA9, 0x40, 0x23, 0xE8, 0xE2, 0xF8, 0x80,
   0xC6, 0x44, 0x44, 0x4C, 0x60, 0x64, 0xA8, 0x8A, 0xC9, 0xA0, 0xD8, 0x00,
   0x6A, 0xA4, 0x00, 0x95, 0x58, 0x00, 0x25, 0x5D, 0xF7, 0x54, 0x80, 0x21,
@@ -43,7 +43,7 @@ const uint8_t FixedMono5x7Bitmaps[] PROGMEM = {
   0x29, 0x44, 0x88, 0x00, 0xFE, 0x00, 0xA2, 0x14, 0xA0, 0x00, 0xED, 0xC0
 };
 
-const GFXglyph FixedMono5x7Glyphs[] PROGMEM = {
+constexpr GFXglyph FixedMono5x7Glyphs[] PROGMEM = {
   {     0,   0,   1,   6,    0,    0 }   // ' '
  ,{     0,   1,   7,   6,    2,   -7 }   // '!'
  ,{     1,   3,   2,   6,    1,   -7 }   // '"'
@@ -141,7 +141,7 @@ const GFXglyph FixedMono5x7Glyphs[] PROGMEM = {
  ,{   382,   5,   2,   6,    0,   -4 }   // '~'
 };
 
-const GFXfont Font5x7FixedMono PROGMEM = {
+constexpr GFXfont Font5x7FixedMono PROGMEM = {
 (uint8_t  *)FixedMono5x7Bitmaps,
 (GFXglyph *)FixedMono5x7Glyphs,
 0x20, 0x7E, 7};
\ No newline at end of file
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <Wire.h>
+
+// I2C writes waiting for loop(), each stored as its length then its bytes, in a ring that holds two full length writes
+// or several short ones, so a host streaming full writes back to back has the next one taken while loop() runs one. The Wire receive callback is the only producer and loop() the only consumer, and each side
+// only writes its own index, so neither has to disable interrupts. loop() parses a write where it lies in the ring
+// and only then releases it, so it needs no copy and the callback never writes over a write being parsed.
+#define COMMAND_MAX_LENGTH 32                         // the Wire receive buffer on 512 byte SRAM parts
+#define COMMAND_QUEUE_SIZE (2 * (COMMAND_MAX_LENGTH + 1) + 1) // two full writes with their lengths and the byte
+                                                              // that tells full from empty
+
+volatile uint8_t commandQueue[COMMAND_QUEUE_SIZE];
+volatile uint8_t commandHead = 0; // next byte the callback writes
+volatile uint8_t commandTail = 0; // first byte of the oldest write
+uint16_t commandOverflows = 0;    // writes dropped because the queue was full
+
+inline uint8_t commandQueueNext(uint8_t index)
+{
+  return index + 1 == COMMAND_QUEUE_SIZE ? 0 : index + 1;
+}
+
+// reads a queued write in place, the way Wire.read() and Wire.available() do
+struct CommandReader
+{
+  uint8_t position; // ring index of the next byte
+  uint8_t length;
+  uint8_t index;
+
+  int available() { return length - index; }
+  int read()
+  {
+    if (index >= length)
+    {
+      return -1;
+    }
+    uint8_t value = commandQueue[position];
+    position = commandQueueNext(position);
+    index++;
+    return value;
+  }
+};
+
+// copies length bytes from Wire into the queue, drops the write if it does not fit
+bool commandQueuePush(uint8_t length)
+{
+  uint8_t head = commandHead;
+  uint8_t used = head >= commandTail ? head - commandTail : head + COMMAND_QUEUE_SIZE - commandTail;
+  if (length > COMMAND_MAX_LENGTH || COMMAND_QUEUE_SIZE - 1 - used < length + 1)
+  {
+    commandOverflows++;
+    return false;
+  }
+
+  commandQueue[head] = length;
+  head = commandQueueNext(head);
+  for (uint8_t i = 0; i < length; i++)
+  {
+    commandQueue[head] = Wire.read();
+    head = commandQueueNext(head);
+  }
+  commandHead = head; // publish only once the bytes are in
+  return true;
+}
+
+bool commandQueueEmpty()
+{
+  return commandHead == commandTail;
+}
+
+// points in at the oldest queued write, returns false if there is none
+bool commandQueuePeek(CommandReader &in)
+{
+  uint8_t tail = commandTail;
+  if (tail == commandHead)
+  {
+    return false;
+  }
+
+  in.length = commandQueue[tail];
+  in.position = commandQueueNext(tail);
+  in.index = 0;
+  return true;
+}
+
+// releases the oldest queued write once it has been parsed
+void commandQueuePop()
+{
+  uint8_t tail = commandTail + 1 + commandQueue[commandTail];
+  commandTail = tail >= COMMAND_QUEUE_SIZE ? tail - COMMAND_QUEUE_SIZE : tail;
+}
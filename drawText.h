@@ -1,14 +1,28 @@
 #pragma once
 
+#include "packedFont.h"
 #include "scanMatrix.h"
 
-#if defined(MATRIX_16X16)
 #include "Font4x5Fixed.h"
-const GFXfont FONT = Font4x5Fixed;
-#elif defined(MATRIX_8X8)
 #include "Picopixel.h"
-const GFXfont FONT = Picopixel;
-#endif
+
+// Picopixel on short panels, the blockier 4x5 once there are 16 rows for it, only the chosen one is packed into flash
+constexpr const GFXfont &FONT_SOURCE = NUM_ROWS >= 16 ? Font4x5Fixed : Picopixel;
+
+typedef PACKED_FONT(FONT_SOURCE) font_t;
+constexpr font_t FONT PROGMEM = packFont<font_t>(FONT_SOURCE);
+
+#define MAX_MESSAGE_SIZE 140 // longest string drawn, terminator included
+
+// prefix width index, widths[i] is the width of the first i * TEXT_INDEX_STRIDE characters of a string
+#define TEXT_INDEX_STRIDE 16
+#define TEXT_INDEX_SIZE ((MAX_MESSAGE_SIZE + TEXT_INDEX_STRIDE - 1) / TEXT_INDEX_STRIDE)
+
+struct TextIndex
+{
+  uint16_t widths[TEXT_INDEX_SIZE];
+  uint8_t count;
+};
 
 void drawPixel(int x, int y, bool on) {
   scanSetPixel(x, y, on);
@@ -16,17 +30,7 @@ void drawPixel(int x, int y, bool on) {
 
 uint8_t getCharWidth(unsigned char c)
 {
-  uint16_t first = pgm_read_byte(&FONT.first);
-  uint16_t last = pgm_read_byte(&FONT.last);
-  uint8_t charWidth = 0;
-
-  if ((c >= first) && (c <= last)) // Char present in this font?
-  {
-    GFXglyph *glyph = &(((GFXglyph *)pgm_read_ptr(&FONT.glyph))[c - first]);
-    charWidth = pgm_read_byte(&glyph->xAdvance);
-  }
-
-  return charWidth;
+  return packedCharWidth(FONT, c);
 }
 
 uint16_t getTextWidth(const char *str)
@@ -40,50 +44,102 @@ uint16_t getTextWidth(const char *str)
   return width;
 }
 
-void drawChar(uint16_t x, uint16_t y, char c, uint32_t color, uint8_t &glyphWidth)
+// builds the index for str in one walk over the glyph table, returns the total width
+uint16_t buildTextIndex(const char *str, TextIndex &index)
 {
-  uint8_t first = pgm_read_byte(&FONT.first);
-  uint8_t last = pgm_read_byte(&FONT.last);
-  if ((c < first) || (c > last)) // Char present in this font?
+  uint16_t width = 0;
+  index.count = 0;
+  for (uint8_t i = 0; str[i]; i++)
   {
-    glyphWidth = 0;
-    return;
+    if (i % TEXT_INDEX_STRIDE == 0 && index.count < TEXT_INDEX_SIZE)
+    {
+      index.widths[index.count++] = width;
+    }
+    width += getCharWidth(str[i]);
+  }
+  return width;
+}
+
+// last sample at or before x pixels into the string
+uint8_t findTextIndex(const TextIndex &index, int16_t x)
+{
+  uint8_t lo = 0;
+  uint8_t hi = index.count;
+  while (hi - lo > 1)
+  {
+    uint8_t mid = (lo + hi) / 2;
+    if ((int16_t)index.widths[mid] <= x)
+      lo = mid;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+// column col of a character cell at baseline y, bit n set for each lit row n
+uint32_t getCharColumn(unsigned char c, uint8_t col, int16_t y)
+{
+  int16_t top = y + font_t::top;
+  if (top >= NUM_ROWS || top + font_t::height <= 0)
+  {
+    return 0;
   }
 
-  GFXglyph *glyph = &(((GFXglyph *)pgm_read_ptr(&FONT.glyph))[c - first]);
-  uint8_t *bitmap = (uint8_t *)pgm_read_ptr(&FONT.bitmap);
-  int count = 0;
+  uint32_t column = packedCharColumn(FONT, c, col - font_t::left);
+  column = top >= 0 ? column << top : column >> -top;
+  return column & (uint32_t)(((uint64_t)1 << NUM_ROWS) - 1);
+}
 
-  uint16_t bo = pgm_read_word(&glyph->bitmapOffset);
-  uint8_t w = pgm_read_byte(&glyph->width);
-  uint8_t h = pgm_read_byte(&glyph->height);
-  int8_t xo = pgm_read_byte(&glyph->xOffset);
-  int8_t yo = pgm_read_byte(&glyph->yOffset);
-  uint8_t xx, yy, bits = 0, bit = 0;
+// blits a glyph a row at a time, each glyph row is gathered from the packed columns as a mask, shifted into place and
+// OR'd into the frame
+void drawChar(int16_t x, int16_t y, char c, uint32_t color, uint8_t &glyphWidth)
+{
+  glyphWidth = packedCharWidth(FONT, c);
 
-  for (yy = 0; yy < h; yy++)
+  // clip whole glyph
+  int16_t left = x + font_t::left;
+  int16_t top = y + font_t::top;
+  if (left >= NUM_COLS || left + font_t::width <= 0 || top >= NUM_ROWS || top + font_t::height <= 0)
   {
-    for (xx = 0; xx < w; xx++)
+    return;
+  }
+
+  font_t::column_t columns[font_t::width];
+  font_t::column_t lit = 0;
+  for (uint8_t xx = 0; xx < font_t::width; xx++)
+  {
+    columns[xx] = packedCharColumn(FONT, c, xx);
+    lit |= columns[xx];
+  }
+
+  for (uint8_t yy = 0; lit; yy++, lit >>= 1)
+  {
+    int16_t row = top + yy;
+    if (!(lit & 1) || row < 0 || row >= NUM_ROWS)
     {
-      if (!(bit++ & 7))
-      {
-        bits = pgm_read_byte(&bitmap[bo++]);
-      }
-      if (bits & 0x80)
-      {
-        drawPixel(x + xo + xx, y + yo + yy, color);
-        count++;
-      }
-      bits <<= 1;
+      continue;
     }
-  }
 
-  glyphWidth = (uint8_t)pgm_read_byte(&glyph->xAdvance);
+    // bit xx of the glyph row is pixel xx, same as the frame rows
+    uint16_t glyphRow = 0;
+    for (uint8_t xx = 0; xx < font_t::width; xx++)
+    {
+      glyphRow |= ((columns[xx] >> yy) & 1) << xx;
+    }
+
+    rowdata_t mask = left >= 0 ? (rowdata_t)((rowdata_t)glyphRow << left) : (rowdata_t)(glyphRow >> -left);
+    scanBlitRow(row, mask, color);
+  }
 }
 
 void drawString(int16_t x, int16_t y, int16_t max_x, int16_t max_y, const char *str, uint32_t color)
 {
-  // TODO: check y
+  // skip strings entirely above or below the frame, glyphs never reach more than a line from the baseline
+  int16_t lineHeight = font_t::yAdvance;
+  if (y - lineHeight >= max_y || y + lineHeight <= 0)
+  {
+    return;
+  }
 
   while (*str && x < max_x)
   {
@@ -93,3 +149,75 @@ void drawString(int16_t x, int16_t y, int16_t max_x, int16_t max_y, const char *
     str++;
   }
 }
+
+// same as drawString(), but starts at the first indexed sample that reaches the left edge
+void drawString(int16_t x, int16_t y, int16_t max_x, int16_t max_y, const char *str, uint32_t color, const TextIndex &index)
+{
+  if (x < 0 && index.count > 0)
+  {
+    uint8_t sample = findTextIndex(index, -x);
+    str += sample * TEXT_INDEX_STRIDE;
+    x += index.widths[sample];
+  }
+
+  drawString(x, y, max_x, max_y, str, color);
+}
+
+// number of characters of str that fit in maxWidth pixels, breaking after the last whole word that fits, at a '|', or
+// mid-word for a word too long for a line of its own. Trailing spaces are left out of the count and of width
+uint8_t wrapTextLine(const char *str, uint16_t maxWidth, uint16_t &width)
+{
+  uint8_t length = 0;
+  uint8_t wordEnd = 0;
+  uint16_t wordEndWidth = 0;
+  width = 0;
+  for (char c; (c = str[length]) && c != '|'; length++)
+  {
+    if (c == ' ' && length > 0 && str[length - 1] != ' ')
+    {
+      wordEnd = length;
+      wordEndWidth = width;
+    }
+
+    uint8_t charWidth = getCharWidth(c);
+    if (width + charWidth > maxWidth && c != ' ')
+    {
+      if (wordEnd > 0)
+      {
+        width = wordEndWidth;
+        return wordEnd;
+      }
+      return length > 0 ? length : 1; // always take a character
+    }
+    width += charWidth;
+  }
+
+  while (length > 0 && str[length - 1] == ' ')
+  {
+    width -= getCharWidth(' ');
+    length--;
+  }
+  return length;
+}
+
+// pixel row glyphRow of the cell of the first length characters of str from x, as a frame row
+rowdata_t getTextRow(const char *str, uint8_t length, int16_t x, uint8_t glyphRow)
+{
+  rowdata_t row = 0;
+  for (uint8_t i = 0; i < length && x < NUM_COLS; i++)
+  {
+    char c = str[i];
+    int16_t left = x + font_t::left;
+    if (left + font_t::width > 0)
+    {
+      uint16_t bits = 0;
+      for (uint8_t xx = 0; xx < font_t::width; xx++)
+      {
+        bits |= ((packedCharColumn(FONT, c, xx) >> glyphRow) & 1) << xx;
+      }
+      row |= left >= 0 ? (rowdata_t)((rowdata_t)bits << left) : (rowdata_t)(bits >> -left);
+    }
+    x += getCharWidth(c);
+  }
+  return row;
+}
@@ -1,9 +1,13 @@
+#include <avr/sleep.h>
 #include <tinyNeoPixel_static.h>
 #include <Wire.h>
 
+#include "commandQueue.h"
 #include "drawText.h"
+#include "savedConfig.h"
 #include "scrollAnim.h"
 #include "scrollText.h"
+#include "spriteAnim.h"
 #include "scanMatrix.h"
 
 #define I2C_ADDRESS 0x15
@@ -15,154 +19,565 @@
 #define STATUS_UPDATE_INTERVAL 500
 #define TEMP_MESSAGE_DURATION 5000
 
-#if defined(MATRIX_16X16)
-#define DEFAULT_DRAW_UPDATE_INTERVAL 100
-#elif defined(MATRIX_8X8)
-#define DEFAULT_DRAW_UPDATE_INTERVAL 120
-#endif
+#define DEFAULT_DRAW_UPDATE_INTERVAL (NUM_ROWS >= 16 ? 100 : 120)
 
 enum Mode
 {
   ScrollAnim,
-  ScrollText
+  ScrollText,
+  SpriteAnim,
+  UploadAnim,
+  ScrollUp,  // message lines scrolling up
+  ScrollPage // message lines scrolling up a line at a time
 };
 
+// I2C register protocol: a write is a start address then bytes for it and the registers after it, so one
+// transaction can set several registers. Writes run from loop() through the command queue, so they take effect
+// within a loop pass. Reads come from a separate telemetry map at the read address. An address byte on its own
+// sets the read address, and each read sets it back to 0, so a one byte read still gets the switch state.
+
+// write registers
+#define REG_DISPLAY 0x00     // 0 off, 1 on
+#define REG_MODE 0x01        // Mode
+#define REG_SPEED 0x02       // scroll speed 0-100
+#define REG_BRIGHTNESS 0x03
+#define REG_REFRESH 0x04     // uint16_t frames per second, applied when the high byte is written, 0 is ignored
+#define REG_ANIMATION 0x06   // sprite animation played in SpriteAnim mode
+#define REG_COMMIT 0x07      // COMMIT_* action
+#define REG_PIXEL_X 0x08     // pixel window, writing the level draws the pixel over the current frame and
+#define REG_PIXEL_Y 0x09     // wraps back to x, so a write streams (x, y, level) triplets
+#define REG_PIXEL_LEVEL 0x0A
+#define REG_UPLOAD 0x0B      // UPLOAD_* action for the animation played in UploadAnim mode, blank until there is
+                             // one, kept in EEPROM (CONFIG_UPLOAD_SIZE bytes) across power cycles
+#define REG_UPLOAD_DATA 0x0C // upload bytes, a write to it streams in the header and packed frames (spriteAnim.h)
+#define REG_DELTA 0x0D       // delta frame, only as the start of a write: a little-endian row mask, then the rows for
+                             // its set bits, the others keep the last frame, shown when the write ends
+#define REG_MESSAGE 0x10     // scroll message text, NUL terminated, written straight into scrollMessage, the text
+                             // modes hold their frame from the first byte until COMMIT_SCROLL_MESSAGE
+#define REG_MESSAGE_END (REG_MESSAGE + MAX_MESSAGE_SIZE - 1)
+#define REG_MESSAGE_LIMIT 0xA0 // bytes from REG_MESSAGE_END to here are dropped and counted as truncated
+#define REG_FRAME 0xA0       // little-endian rows drawn over the current frame, shown when the write ends
+#define REG_FRAME_HOLD 0xC0  // the same rows, held back until a later write to REG_FRAME or COMMIT_FRAME
+#define REG_TEMP_MESSAGE 0xE0 // temporary message text, NUL terminated, shown by COMMIT_TEMP_MESSAGE
+#define REG_TEMP_MESSAGE_END (REG_TEMP_MESSAGE + TEMP_MESSAGE_SIZE - 1)
+#define REG_NONE 0xFF        // bytes from REG_TEMP_MESSAGE_END to here are dropped and counted as truncated
+#define FRAME_WINDOW (REG_FRAME_HOLD - REG_FRAME)
+#define FRAME_BYTES (NUM_ROWS * sizeof(rowdata_t))
+#define DELTA_MASK_BYTES ((NUM_ROWS + 7) / 8)
+static_assert(FRAME_BYTES <= FRAME_WINDOW, "frame too big for the register map");
+static_assert(REG_MESSAGE_END <= REG_MESSAGE_LIMIT, "MAX_MESSAGE_SIZE too big for the register map");
+static_assert(CONFIG_MESSAGE_SIZE <= MAX_MESSAGE_SIZE, "the saved message is loaded into scrollMessage");
+
+// a temporary message is centered on the panel, so it takes two lines of NUM_COLS / 2 narrow characters at most
+#define TEMP_MESSAGE_SIZE (NUM_COLS + 2 < REG_NONE - REG_TEMP_MESSAGE ? NUM_COLS + 2 : REG_NONE - REG_TEMP_MESSAGE)
+
+#define COMMIT_SCROLL_MESSAGE 0x01 // scroll the message
+#define COMMIT_TEMP_MESSAGE 0x02   // show the message centered for TEMP_MESSAGE_DURATION, "line1|line2" for two lines
+#define COMMIT_FRAME 0x03          // show held frame rows
+
+#define UPLOAD_BEGIN 0x01 // start a new upload, bytes after it in the same write go to REG_UPLOAD_DATA
+#define UPLOAD_END 0x02   // check the upload and play it, a bad one is dropped and blinks the status LED
+static_assert(CONFIG_UPLOAD_SIZE >= 1 + SPRITE_UPLOAD_HEADER + 1 + (NUM_ROWS + 7) / 8 + NUM_ROWS * ((NUM_COLS + 7) / 8),
+              "CONFIG_UPLOAD_SIZE too small for a full frame");
+
+// read registers, little-endian
+#define REG_SWITCH_STATE 0x00     // uint8_t
+#define REG_READ_MODE 0x01        // uint8_t
+#define REG_FRAMES_SHOWN 0x02     // uint32_t, frames the scan put on display
+#define REG_FRAMES_DROPPED 0x06   // uint32_t, frames replaced by a newer one before they were displayed
+#define REG_MESSAGES 0x0A         // uint32_t, I2C writes received
+#define REG_TRUNCATED 0x0E        // uint16_t, writes that ran past the end of a message or the upload, or
+                                  // ended before the rows of a delta frame
+#define REG_UNMAPPED_WRITES 0x10  // uint16_t, writes to addresses with no register
+#define REG_UPTIME 0x12           // uint32_t, seconds
+#define REG_QUEUE_OVERFLOWS 0x16  // uint16_t, writes dropped because the command queue was full
+#define REG_REFRESH_RATE 0x18     // uint16_t, frames per second achieved
+#define REG_STATS 0x1A            // ScanStats as nine uint16_t, a read starting here ends the stats window, zero
+                                  // if built with -DSCAN_STATS=0
+#define REG_STACK_FREE 0x2C       // uint16_t, bytes of SRAM the stack has never reached since power on, zero on the
+                                  // host build
+#define REG_MAP_SIZE 0x2E
+
 // i2c
 bool statusLedState = false;
 bool statusLedFirstBlink = false;
 uint8_t statusLedBlinks = 0; // number of extra short blinks after long "ACK" blink
-unsigned long lastStatusLedUpdate = 0;
-unsigned long drawUpdateInterval = DEFAULT_DRAW_UPDATE_INTERVAL;
-unsigned long statusLedUpdateInterval = STATUS_UPDATE_INTERVAL;
+// ms times and intervals that stay well under a minute keep the low 16 bits of millis()
+uint16_t lastStatusLedUpdate = 0;
+uint16_t drawUpdateInterval = DEFAULT_DRAW_UPDATE_INTERVAL; // ms per scroll step
+uint16_t statusLedUpdateInterval = STATUS_UPDATE_INTERVAL;
+volatile uint8_t readAddress = REG_SWITCH_STATE;
+uint32_t i2cMessages = 0;
+uint16_t truncatedMessages = 0; // counted by loop() and read from the TWI interrupt, see countError()
+uint16_t unmappedWrites = 0;
+
+// register state between writes
+char tempMessage[TEMP_MESSAGE_SIZE];
+uint8_t refreshLow = 0;
+uint8_t pixel[3]; // x, y, level
+rowdata_t frameRow = 0;  // row being written, set once its last byte is in
+bool drawing = false;    // the draw buffer holds the last frame plus register writes, not yet shown
+bool drawHeld = false;
+uint8_t animation = 0;   // built-in sprite animation for SpriteAnim mode
+uint8_t brightness = DEFAULT_BRIGHTNESS;
 
 // display state
 volatile bool display = true;
 Mode mode = Mode::ScrollAnim;
-unsigned long lastDrawUpdate = 0;
+// scroll pacing, steps advance on whole scan frames at scrollVelocity steps per frame in 16.16 fixed point, so
+// every frame shown is rendered once and motion stays even at any refresh rate
+uint32_t scrollVelocity = 0;
+uint16_t scrollPhase = 0; // fraction of a step
+uint16_t lastVsync = 0;
+
+// steps per scan frame for drawUpdateInterval ms per step at the refresh rate achieved
+void updateScrollVelocity()
+{
+  uint32_t msPerFrameStep = (uint32_t)drawUpdateInterval * scanRefreshRate();
+  scrollVelocity = (65536000UL + msPerFrameStep / 2) / msPerFrameStep;
+}
 
-void handleOnReceive(int bytesReceived)
+// counts a bad write from loop() with interrupts off, so a read from the TWI interrupt never gets half an increment
+void countError(uint16_t &counter)
 {
-  statusLedState = true;
-  digitalWrite(STATUS_LED_PIN, !statusLedState);
-  lastStatusLedUpdate = millis();
-  statusLedBlinks = 0;
-  statusLedFirstBlink = true;
+  uint8_t oldSREG = SREG;
+  cli();
+  counter++;
+  SREG = oldSREG;
+}
 
-  if (bytesReceived < 2)
+// starts drawing register writes over the last frame, the animation holds off until they are shown
+void beginDraw()
+{
+  if (!drawing)
   {
-    return;
+    scanRetain();
+    drawing = true;
   }
+  lastTempMessage = millis();
+}
 
-  static char buffer[MAX_MESSAGE_SIZE];
-  static int bufferIndex = 0;
+void showDraw()
+{
+  if (drawing)
+  {
+    scanShow();
+    drawing = false;
+    lastTempMessage = millis();
+  }
+}
 
-  uint8_t command = Wire.read();
-  statusLedBlinks = command + 1; // use value to blink status LED
+// forgets register writes not yet shown, for code that clears or shows the draw buffer itself
+void dropDraw()
+{
+  drawing = false;
+  drawHeld = false;
+}
+
+// centers "line1|line2" on two lines or a single line in the middle
+void showTempMessage(char *text)
+{
+  char* pipe = strchr(text, '|');
 
-  // setDisplay
-  if (command == 0x00)
+  dropDraw();
+  scanClear();
+  if (pipe != nullptr)
   {
-    display = Wire.read();
+    // split into two C-strings in-place, put back once drawn
+    *pipe = '\0';
+    const char* line1 = text;
+    const char* line2 = pipe + 1;
+
+    uint8_t line1Width = getTextWidth(line1);
+    uint8_t line2Width = getTextWidth(line2);
+
+    // Center each line horizontally, split display in half vertically
+    uint16_t line1X = (MATRIX_WIDTH  - line1Width) / 2;
+    uint16_t line2X = (MATRIX_WIDTH  - line2Width) / 2 + 1;
+    const uint8_t line1Y = 6;
+    const uint8_t line2Y = 13;
+
+    drawString(line1X, line1Y, MATRIX_WIDTH, MATRIX_HEIGHT, line1, true);
+    drawString(line2X, line2Y, MATRIX_WIDTH, MATRIX_HEIGHT, line2, true);
+    *pipe = '|';
+  }
+  else
+  {
+    // Single line — center horizontally and vertically
+    uint8_t textWidth = getTextWidth(text);
+    uint8_t x = (MATRIX_WIDTH  - textWidth) / 2 + 1;
+    const uint8_t y = 10;
+
+    drawString(x, y, MATRIX_WIDTH, MATRIX_HEIGHT, text, true);
+  }
+  scanShow();
+
+  lastTempMessage = millis();
+}
+
+void commit(uint8_t action)
+{
+  if (action == COMMIT_SCROLL_MESSAGE)
+  {
+    scrollTextUpdate();
+    configChanged();
+  }
+  else if (action == COMMIT_TEMP_MESSAGE)
+  {
+    showTempMessage(tempMessage);
+  }
+  else if (action == COMMIT_FRAME)
+  {
+    showDraw();
+  }
+}
+
+// writes one register, returns the address the next byte goes to or REG_NONE to drop the rest of the write
+uint8_t writeRegister(uint8_t address, uint8_t value)
+{
+  if (address == REG_DISPLAY)
+  {
+    display = value;
     scanDisplay(display);
+    configChanged();
   }
-  // setMessage and showTempMessage
-  else if (command == 0x01 || command == 0x04)
+  else if (address == REG_MODE)
   {
-    // read chunk into buffer, discard extra bytes if past buffer size
-    while (Wire.available())
+    if (value > Mode::ScrollPage)
     {
-      uint8_t byte = Wire.read();
-      if (bufferIndex < MAX_MESSAGE_SIZE - 1)
-      {
-        buffer[bufferIndex++] = byte;
-      }
+      countError(unmappedWrites);
+      return REG_NONE;
     }
-    buffer[bufferIndex] = '\0';
+    mode = (Mode)value;
+    scrollTextInvalidate();
+    if (mode == Mode::UploadAnim)
+    {
+      spriteAnimSelectUploaded();
+    }
+    else
+    {
+      spriteAnimSelect(animation);
+    }
+    configChanged();
+  }
+  else if (address == REG_SPEED)
+  {
+    drawUpdateInterval = map(constrain(value, 0, 100), 100, 0, MIN_UPDATE_INTERVAL, MAX_UPDATE_INTERVAL);
+    updateScrollVelocity();
+    configChanged();
+  }
+  else if (address == REG_BRIGHTNESS)
+  {
+    brightness = value;
+    scanSetBrightness(brightness);
+    configChanged();
+  }
+  else if (address == REG_REFRESH)
+  {
+    refreshLow = value;
+  }
+  else if (address == REG_REFRESH + 1)
+  {
+    uint16_t refreshRate = refreshLow | (uint16_t)value << 8;
+    if (refreshRate != 0)
+    {
+      scanSetRefreshRate(refreshRate);
+      updateScrollVelocity();
+    }
+  }
+  else if (address == REG_ANIMATION)
+  {
+    animation = value;
+    if (mode == Mode::SpriteAnim)
+    {
+      spriteAnimSelect(animation);
+    }
+    configChanged();
+  }
+  else if (address == REG_COMMIT)
+  {
+    commit(value);
+  }
+  else if (address >= REG_PIXEL_X && address <= REG_PIXEL_LEVEL)
+  {
+    pixel[address - REG_PIXEL_X] = value;
+    if (address == REG_PIXEL_LEVEL)
+    {
+      beginDraw();
+      drawHeld = false;
+      scanSetPixelLevel(pixel[0], pixel[1], pixel[2]);
+      return REG_PIXEL_X;
+    }
+  }
+  else if (address == REG_UPLOAD)
+  {
+    if (value == UPLOAD_BEGIN)
+    {
+      spriteUploadBegin();
+    }
+    else if (value == UPLOAD_END && !spriteUploadEnd())
+    {
+      return REG_NONE;
+    }
+  }
+  else if (address == REG_UPLOAD_DATA)
+  {
+    if (!spriteUploadWrite(value))
+    {
+      countError(truncatedMessages);
+      return REG_NONE;
+    }
+    return REG_UPLOAD_DATA;
+  }
+  else if (address >= REG_MESSAGE && address < REG_MESSAGE_END)
+  {
+    if (!scrollTextEditing)
+    {
+      configChanged(); // drops a save that would catch the message half written
+    }
+    scrollTextWrite(address - REG_MESSAGE, value);
+  }
+  else if (address >= REG_MESSAGE_END && address < REG_MESSAGE_LIMIT)
+  {
+    countError(truncatedMessages);
+    return REG_NONE; // the rest of the write is past the message
+  }
+  else if (address >= REG_FRAME && address < REG_FRAME_HOLD + FRAME_WINDOW)
+  {
+    uint8_t offset = (address - REG_FRAME) % FRAME_WINDOW;
+    if (offset >= FRAME_BYTES)
+    {
+      countError(unmappedWrites);
+      return REG_NONE;
+    }
+
+    uint8_t byte = offset % sizeof(rowdata_t);
+    beginDraw();
+    drawHeld = address >= REG_FRAME_HOLD;
 
-    // last chunk (or buffer overflow)
-    if (bufferIndex > 0 && (buffer[bufferIndex - 1] == '\n' || bufferIndex >= MAX_MESSAGE_SIZE - 1))
+    // rows are set whole once their last byte is in
+    frameRow = (byte == 0 ? 0 : frameRow) | (rowdata_t)value << (8 * byte);
+    if (byte == sizeof(rowdata_t) - 1)
     {
-      if (buffer[bufferIndex - 1] == '\n')
-      {
-        buffer[--bufferIndex] = '\0';
-      }
+      scanSetRow(offset / sizeof(rowdata_t), frameRow);
+    }
+  }
+  else if (address >= REG_TEMP_MESSAGE && address < REG_TEMP_MESSAGE_END)
+  {
+    tempMessage[address - REG_TEMP_MESSAGE] = value;
+  }
+  else if (address >= REG_TEMP_MESSAGE_END && address < REG_NONE)
+  {
+    countError(truncatedMessages);
+    return REG_NONE;
+  }
+  else
+  {
+    countError(unmappedWrites);
+    return REG_NONE;
+  }
+  return address + 1;
+}
+
+// decodes a REG_DELTA write into the draw buffer in one pass, rows outside the mask are copied from the last frame a
+// row at a time, or kept as they are over a held draw, returns false if the write ended before its rows
+bool writeDelta(CommandReader &in)
+{
+  if (in.available() < DELTA_MASK_BYTES)
+  {
+    countError(truncatedMessages);
+    return false;
+  }
+  uint32_t rowMask = 0;
+  for (uint8_t i = 0; i < DELTA_MASK_BYTES; i++)
+  {
+    rowMask |= (uint32_t)in.read() << (8 * i);
+  }
 
-      if (command == 0x01)
+  const bool retained = drawing;
+  drawing = true;
+  drawHeld = false;
+  lastTempMessage = millis();
+  bool complete = true;
+  for (uint8_t row = 0; row < NUM_ROWS; row++)
+  {
+    if (rowMask & ((uint32_t)1 << row))
+    {
+      if (in.available() >= (int)sizeof(rowdata_t))
       {
-        scrollTextSetMessage(buffer);
+        rowdata_t rowData = 0;
+        for (uint8_t i = 0; i < sizeof(rowdata_t); i++)
+        {
+          rowData |= (rowdata_t)in.read() << (8 * i);
+        }
+        scanSetRow(row, rowData);
+        continue;
       }
-      else // command == 0x04
-      {
-        // TODO: str length checking
+      complete = false;
+    }
+    if (!retained)
+    {
+      scanRetainRow(row);
+    }
+  }
+  if (!complete)
+  {
+    countError(truncatedMessages);
+  }
+  return complete;
+}
 
-        // Parse "line1|line2" format
-        char* pipe = strchr(buffer, '|');
+// runs one I2C write, from loop() through the command queue
+void handleCommand(CommandReader &in)
+{
+  statusLedState = true;
+  digitalWrite(STATUS_LED_PIN, !statusLedState);
+  lastStatusLedUpdate = millis();
+  statusLedBlinks = 0;
+  statusLedFirstBlink = true;
 
-        if (pipe != nullptr)
-        {
-          // Split into two C-strings in-place
-          *pipe = '\0';
-          const char* line1 = buffer;
-          const char* line2 = pipe + 1;
-
-          uint8_t line1Width = getTextWidth(line1);
-          uint8_t line2Width = getTextWidth(line2);
-
-          // Center each line horizontally, split display in half vertically
-          uint16_t line1X = (MATRIX_WIDTH  - line1Width) / 2;
-          uint16_t line2X = (MATRIX_WIDTH  - line2Width) / 2 + 1;
-          const uint8_t line1Y = 6;
-          const uint8_t line2Y = 13;
-
-          scanClear();
-          drawString(line1X, line1Y, MATRIX_WIDTH, MATRIX_HEIGHT, line1, true);
-          drawString(line2X, line2Y, MATRIX_WIDTH, MATRIX_HEIGHT, line2, true);
-          scanShow();
-        }
-        else
-        {
-          // Single line — center horizontally and vertically
-          uint8_t textWidth = getTextWidth(buffer);
-          uint8_t x = (MATRIX_WIDTH  - textWidth) / 2 + 1;
-          const uint8_t y = 10;
-
-          scanClear();
-          drawString(x, y, MATRIX_WIDTH, MATRIX_HEIGHT, buffer, true);
-          scanShow();
-        }
+  if (in.length < 2)
+  {
+    return;
+  }
 
-        lastTempMessage = millis();
+  uint8_t address = in.read();
+  statusLedBlinks = 1;
+  if (address == REG_DELTA)
+  {
+    statusLedBlinks = writeDelta(in) ? 1 : 10;
+  }
+  else
+  {
+    while (in.available())
+    {
+      address = writeRegister(address, in.read());
+      if (address == REG_NONE)
+      {
+        statusLedBlinks = 10;
+        break;
       }
-      bufferIndex = 0;
     }
   }
-  // setScrollSpeed
-  else if (command == 0x02)
+
+  // frame rows and pixels show at the end of the write unless held
+  if (!drawHeld)
+  {
+    showDraw();
+  }
+}
+
+// an address on its own sets the read address and has to take effect before the read that follows, everything else waits for
+// loop() so the callback only copies bytes and never holds the bus or the scan interrupt up with drawing
+void handleOnReceive(int bytesReceived)
+{
+  i2cMessages++;
+
+  if (bytesReceived == 1)
   {
-    uint8_t scrollSpeed = Wire.read();
-    drawUpdateInterval = map(constrain(scrollSpeed, 0, 100), 100, 0, MIN_UPDATE_INTERVAL, MAX_UPDATE_INTERVAL);
+    readAddress = Wire.read();
+    return;
   }
-  // setDisplayMode
-  else if (command == 0x03)
+  commandQueuePush(bytesReceived);
+}
+
+// runs the writes queued since the last call, each parsed where it lies in the queue
+void handleQueuedCommands()
+{
+  CommandReader in;
+  while (commandQueuePeek(in))
   {
-    mode = (Mode)Wire.read();
+    handleCommand(in);
+    commandQueuePop();
   }
-  else
+}
+
+// stack low-water mark, the SRAM between the globals and the stack is painted before main() runs and the bytes the
+// stack never reached still hold the paint, so ram_check.py's reserve can be checked on a running panel
+#ifdef __AVR__
+#define STACK_PAINT 0xC5
+extern uint8_t __heap_start;
+
+void stackPaint() __attribute__((naked, used, section(".init3")));
+void stackPaint()
+{
+  for (uint8_t *p = &__heap_start; p < (uint8_t *)SP; p++)
   {
-    statusLedBlinks = 10;
+    *p = STACK_PAINT;
+  }
+}
+
+uint16_t stackFree()
+{
+  const uint8_t *p = &__heap_start;
+  while (p < (const uint8_t *)SP && *p == STACK_PAINT)
+  {
+    p++;
+  }
+  return p - &__heap_start;
+}
+#else
+uint16_t stackFree()
+{
+  return 0;
+}
+#endif
+
+// sends the bytes of a register from the read address on, registers go in address order so the map needs no copy
+void putRegister(uint8_t address, uint32_t value, uint8_t size)
+{
+  for (uint8_t i = 0; i < size; i++)
+  {
+    if (address + i >= readAddress)
+    {
+      Wire.write((uint8_t)(value >> (8 * i)));
+    }
   }
 }
 
 void handleOnRequest()
 {
-  bool switchState = digitalRead(SWITCH_PIN);
-  Wire.write((uint8_t)switchState);
+  uint32_t framesShown, framesDropped;
+  scanReadFrameCounts(framesShown, framesDropped);
+
+  putRegister(REG_SWITCH_STATE, digitalRead(SWITCH_PIN), 1);
+  putRegister(REG_READ_MODE, mode, 1);
+  putRegister(REG_FRAMES_SHOWN, framesShown, 4);
+  putRegister(REG_FRAMES_DROPPED, framesDropped, 4);
+  putRegister(REG_MESSAGES, i2cMessages, 4);
+  putRegister(REG_TRUNCATED, truncatedMessages, 2);
+  putRegister(REG_UNMAPPED_WRITES, unmappedWrites, 2);
+  putRegister(REG_UPTIME, millis() / 1000, 4);
+  putRegister(REG_QUEUE_OVERFLOWS, commandOverflows, 2);
+  putRegister(REG_REFRESH_RATE, scanRefreshRate(), 2);
+
+  // only a read of the stats themselves starts a new window
+  ScanStats stats = {};
+#if SCAN_STATS
+  if (readAddress >= REG_STATS && readAddress < REG_STACK_FREE)
+  {
+    scanReadStats(stats);
+  }
+#endif
+  putRegister(REG_STATS, stats.isrMin, 2);
+  putRegister(REG_STATS + 2, stats.isrAvg, 2);
+  putRegister(REG_STATS + 4, stats.isrMax, 2);
+  putRegister(REG_STATS + 6, stats.latencyMax, 2);
+  putRegister(REG_STATS + 8, stats.renderMin, 2);
+  putRegister(REG_STATS + 10, stats.renderAvg, 2);
+  putRegister(REG_STATS + 12, stats.renderMax, 2);
+  putRegister(REG_STATS + 14, stats.isrLoad, 2);
+  putRegister(REG_STATS + 16, stats.renderLoad, 2);
+
+  // counting the paint takes a while, only for reads whose Wire buffer reaches it
+  putRegister(REG_STACK_FREE, readAddress + BUFFER_LENGTH > REG_STACK_FREE ? stackFree() : 0, 2);
+  readAddress = REG_SWITCH_STATE;
 }
 
 void updateStatusLed()
 {
   // status LED indicates when I2C message is received, long blink first, then short blink count indicates status
-  if ((statusLedBlinks > 0 || statusLedState) && millis() - lastStatusLedUpdate > statusLedUpdateInterval)
+  if ((statusLedBlinks > 0 || statusLedState) && (uint16_t)(millis() - lastStatusLedUpdate) > statusLedUpdateInterval)
   {
     statusLedState = !statusLedState;
     digitalWrite(STATUS_LED_PIN, !statusLedState);
@@ -190,6 +605,68 @@ void updateStatusLed()
   }
 }
 
+// writes settings that have settled to EEPROM, a byte per call, never a message still being written
+void saveConfig()
+{
+  if (!scrollTextEditing && configSaveDue())
+  {
+    SavedConfig config = {};
+    config.updateInterval = drawUpdateInterval;
+    config.flags = display ? CONFIG_DISPLAY : 0;
+    config.mode = mode;
+    config.animation = animation;
+    config.brightness = brightness;
+    configSaveBegin(config, scrollMessage);
+  }
+  if (configSaveBusy())
+  {
+    configSaveStep();
+  }
+}
+
+// puts back the settings and scroll message from the last save, returns false if there is none
+bool restoreConfig()
+{
+  SavedConfig config;
+  if (!configLoad(config, scrollMessage))
+  {
+    return false;
+  }
+
+  drawUpdateInterval = constrain(config.updateInterval, MIN_UPDATE_INTERVAL, MAX_UPDATE_INTERVAL);
+  display = config.flags & CONFIG_DISPLAY;
+  mode = config.mode <= Mode::ScrollPage ? (Mode)config.mode : Mode::ScrollAnim;
+  animation = config.animation;
+  brightness = config.brightness;
+  scrollTextUpdate();
+  if (mode == Mode::UploadAnim)
+  {
+    spriteAnimSelectUploaded(); // the upload kept in EEPROM, blank if there is none
+  }
+  else
+  {
+    spriteAnimSelect(animation);
+  }
+  return true;
+}
+
+// idle sleep until the next interrupt, unless an I2C write came in since loop() last looked. The scan timer fires
+// every bit plane, so the draw and status LED deadlines are checked at least that often, and a write wakes it
+// through the TWI interrupt. sei() only takes effect after the next instruction, so no interrupt can get in between
+// the check and the sleep and leave a write waiting for the next wake up.
+void idle()
+{
+  cli();
+  if (commandQueueEmpty())
+  {
+    sleep_enable();
+    sei();
+    sleep_cpu();
+    sleep_disable();
+  }
+  sei();
+}
+
 void setup()
 {
   pinMode(STATUS_LED_PIN, OUTPUT);
@@ -200,41 +677,109 @@ void setup()
   Wire.begin(I2C_ADDRESS);
   Wire.onReceive(handleOnReceive);
   Wire.onRequest(handleOnRequest);
+  set_sleep_mode(SLEEP_MODE_IDLE);
 
-  if (mode == Mode::ScrollText)
+  // start straight from the last saved settings and upload, the host does not have to send them again after a
+  // power cut
+  spriteUploadInit(CONFIG_UPLOAD_ADDRESS, CONFIG_UPLOAD_SIZE);
+  if (!restoreConfig() && mode == Mode::ScrollText)
   {
     scrollTextSetMessage("From a wild weird clime that lieth, sublime; out of Space, out of Time.");
   }
   scanInit();
+  scanSetBrightness(brightness);
   scanDisplay(display);
+  updateScrollVelocity();
 
-  delay(500);
-  digitalWrite(STATUS_LED_PIN, true);
+  // power on blink, turned off by updateStatusLed() without holding up the scan
+  statusLedState = true;
+  lastStatusLedUpdate = millis();
 }
 
 void loop()
 {
+  handleQueuedCommands();
   updateStatusLed();
 
-  // check if ready to draw again
+  // draw at most once per scan frame, the idle sleep ends at least every bit plane to check
+  uint16_t vsync = scanVsyncCount();
+  uint16_t frames = vsync - lastVsync;
+  if (frames == 0)
+  {
+    idle();
+    return;
+  }
+  lastVsync = vsync;
+  saveConfig();
+
+  // the scroll holds its place while paused
   bool switchState = digitalRead(SWITCH_PIN);
-  if (millis() - lastDrawUpdate < drawUpdateInterval || !display || !switchState || (lastTempMessage != 0 && millis() - lastTempMessage < TEMP_MESSAGE_DURATION))
+  if (!display || !switchState || (lastTempMessage != 0 && millis() - lastTempMessage < TEMP_MESSAGE_DURATION))
+  {
+    idle();
+    return;
+  }
+  if (lastTempMessage != 0)
+  {
+    // whatever was held over the animation is drawn over from here
+    lastTempMessage = 0;
+    dropDraw();
+    scrollTextInvalidate();
+    spriteAnimInvalidate();
+  }
+
+  // sprites keep their own frame times
+  if (mode == Mode::SpriteAnim || mode == Mode::UploadAnim)
+  {
+    // only passes that drew a frame count as renders
+    scanRenderBegin();
+    if (spriteAnim(millis()))
+    {
+      scanRenderEnd();
+    }
+    else
+    {
+      idle();
+    }
+    return;
+  }
+
+  uint32_t phase = scrollPhase + frames * scrollVelocity;
+  uint32_t wholeSteps = phase >> 16;
+  uint8_t steps = wholeSteps < 255 ? wholeSteps : 255;
+  scrollPhase = phase;
+  if (steps == 0)
   {
-    yield();
+    idle();
+    return;
+  }
+
+  // a message being written holds the text modes on their last frame
+  if (scrollTextEditing && mode != Mode::ScrollAnim)
+  {
+    idle();
     return;
   }
-  lastDrawUpdate = millis();
-  lastTempMessage = 0;
 
   // draw for current mode
+  scanRenderBegin();
   switch (mode)
   {
   case ScrollAnim:
-    scrollAnim();
+    scrollAnim(steps);
     break;
   case ScrollText:
-    scrollText();
+    scrollText(steps);
+    break;
+  case ScrollUp:
+    scrollTextVertical(steps, false);
+    break;
+  case ScrollPage:
+    scrollTextVertical(steps, true);
+    break;
+  case SpriteAnim: // drawn above on their own frame times
+  case UploadAnim:
     break;
   }
-  delay(10);
+  scanRenderEnd();
 }
@@ -0,0 +1,432 @@
+// Host benchmarks for the firmware, built against the stand-ins in native/include.
+//
+// Scan ISR: runs the TCB0 scan interrupt (and the SPI0 interrupts it triggers)
+// and reports the hardware operations performed per scan line and per frame,
+// plus a rough ATtiny817 cycle estimate and the resulting share of the CPU,
+// for the build geometry, the other ScanMatrix geometries and chains of
+// panels, then the longest chain the build's panel size allows.
+//
+// Stats: reads the ISR and render pass timings the firmware measured over a
+// simulated second, the ISRs with the TCB0 counter, which follows the cycle
+// model above on the host, and render passes with micros(), which only moves
+// with the simulated millis() so they read 0.
+//
+// Refresh: sets refresh rates over I2C and reads back the rate achieved.
+//
+// I2C frames: streams raw and delta frames through handleOnReceive from a
+// simulated Wire master and reports bus bytes per frame and the frame rate
+// the bus allows.
+//
+// Telemetry: reads the frame and I2C counters from the register map.
+//
+// Text: renders full scroll cycles of a long message with scrollText() and
+// scrollTextVertical() and reports host time per frame.
+//
+//   pio run -e native_8x8 -t exec
+//   pio run -e native_16x16 -t exec
+//   pio run -e native_8x32 -t exec
+//   pio run -e native_32x8 -t exec
+//   pio run -e native_8x8x4 -t exec
+
+#include <chrono>
+#include <stdio.h>
+#include <type_traits>
+
+#include "../main.cpp"
+
+#define BENCH_ISR_CALLS 4000000UL
+#define BENCH_I2C_FRAMES 100000UL
+#define BENCH_DELTA_ROWS 2 // rows changed per delta frame, about a small sprite moving
+#define BENCH_TEXT_CYCLES 2000UL
+#define BENCH_TEXT_MESSAGE "Once upon a midnight dreary, while I pondered, weak and weary, " \
+                           "Over many a quaint and curious volume of forgotten lore"
+
+struct OpCounts
+{
+    double interrupts;
+    double pinWrites;
+    double regAccesses;
+    double spiBytes;
+    double cycles;
+};
+
+static OpCounts scale(const OpCounts &ops, double factor)
+{
+    return {ops.interrupts * factor, ops.pinWrites * factor, ops.regAccesses * factor, ops.spiBytes * factor,
+            ops.cycles * factor};
+}
+
+static void printOps(const char *label, const OpCounts &ops)
+{
+    printf("  %-14s interrupts %6.2f  pin writes %6.2f  reg accesses %7.2f  SPI bytes %6.2f  ~cycles %8.1f\n",
+           label, ops.interrupts, ops.pinWrites, ops.regAccesses, ops.spiBytes, ops.cycles);
+}
+
+// one TCB0 compare match, the scan interrupt and the SPI interrupts it triggers, returns the SPI interrupts
+template <typename M>
+static unsigned runScanIsr()
+{
+    stub::timerMatch(CYCLES_ISR_OVERHEAD / 4); // vector and prologue, half the overhead, in ticks
+    M::scanInterrupt();
+
+    // the SPI interrupt fires whenever it is enabled, by then the wire has caught up
+    unsigned spiIsrCalls = 0;
+    while (SPI0.INTCTRL.value)
+    {
+        stub::spiIdle();
+        M::spiInterrupt();
+        spiIsrCalls++;
+    }
+    return spiIsrCalls;
+}
+
+template <typename M>
+static void benchScanIsr()
+{
+    const unsigned long isrsPerLine = SCAN_BIT_DEPTH + M::blankCycles;
+    const unsigned long isrsPerFrame = M::rows * isrsPerLine;
+    const unsigned long frames = BENCH_ISR_CALLS / isrsPerFrame;
+    unsigned long spiIsrCalls = 0;
+    double timerTicks = 0;
+
+    // other geometries than the build one need their own start, run a frame to finish the fade in
+    M::init();
+    M::display(true);
+    while (M::brightnessLevel != M::brightnessTarget)
+    {
+        runScanIsr<M>();
+    }
+
+    stub::resetCounters();
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long frame = 0; frame < frames; frame++)
+    {
+        // new content every frame so the ISR swap path is always taken
+        for (uint8_t row = 0; row < M::rows; row++)
+        {
+            M::setRow(row, (typename M::rowdata_t)(frame + row));
+        }
+        M::show();
+
+        for (unsigned long i = 0; i < isrsPerFrame; i++)
+        {
+            spiIsrCalls += runScanIsr<M>();
+            timerTicks += TCB0.CCMP.value + 1;
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    const double isrCalls = (double)frames * isrsPerFrame;
+    OpCounts perIsr;
+    perIsr.interrupts = (isrCalls + spiIsrCalls) / isrCalls;
+    perIsr.pinWrites = stub::pinWrites / isrCalls;
+    perIsr.regAccesses = (stub::regReads + stub::regWrites) / isrCalls;
+    perIsr.spiBytes = stub::spiBytes / isrCalls;
+    perIsr.cycles = perIsr.interrupts * CYCLES_ISR_OVERHEAD + perIsr.pinWrites * CYCLES_PIN_WRITE +
+                    perIsr.regAccesses * CYCLES_REG_ACCESS + stub::spiWaitPolls / isrCalls * CYCLES_SPI_POLL +
+                    stub::spiCalls / isrCalls * CYCLES_SPI_CALL;
+
+    const double isrRate = isrCalls * (F_CPU / 2.0) / timerTicks;
+    const double nsPerIsr = std::chrono::duration<double, std::nano>(elapsed).count() / isrCalls;
+
+    printf("scanMatrix %dx%d x%d panels%s, %d bit planes, %d blank cycles, %d frame bytes, %lu ISR calls (%lu frames)\n",
+           M::rows, M::panelCols, M::panels, std::is_same<M, Matrix>::value ? " (build)" : "", SCAN_BIT_DEPTH,
+           M::blankCycles, (int)sizeof(M::frames), (unsigned long)isrCalls, frames);
+    printOps("per ISR", perIsr);
+    printOps("per scan line", scale(perIsr, isrsPerLine));
+    printOps("per frame", scale(perIsr, isrsPerFrame));
+    printf("  avg ISR rate %.0f Hz, refresh %.1f Hz (reported %u Hz), est. CPU in ISR %.1f%%\n",
+           isrRate, isrRate / isrsPerFrame, M::refreshRate, 100.0 * perIsr.cycles * isrRate / F_CPU);
+    printf("  host time %.1f ns per ISR\n", nsPerIsr);
+}
+
+// geometries other than the build one, for comparison
+template <typename M>
+static void benchOtherScanIsr()
+{
+    if (!std::is_same<M, Matrix>::value)
+    {
+        benchScanIsr<M>();
+    }
+}
+
+// Longest chain of the build's panels by each limit: the SPI transfer of a line has to finish within the shortest
+// bit plane at SCAN_REFRESH_RATE or the refresh rate drops, the canvas row is one integer of at most 32 bits, and
+// the frame buffers have to stay within SCAN_FRAME_BUDGET
+static void benchPanelLimit()
+{
+    const unsigned bytesPerPanel = sizeof(Matrix::paneldata_t) + sizeof(Matrix::rowselect_t);
+    const unsigned planeTicks = SCAN_TICK_HZ / (SCAN_REFRESH_RATE * NUM_ROWS * (1 + NUM_BLANK_CYCLES)) / SCAN_MAX_LEVEL;
+    const unsigned spiLimit = (planeTicks - 50) / (bytesPerPanel * 32);
+    const unsigned widthLimit = 32 / Matrix::panelCols;
+
+    unsigned sramLimit = 0;
+    for (unsigned panels = 1; panels <= widthLimit; panels++)
+    {
+        unsigned canvasBits = Matrix::panelCols * panels;
+        unsigned rowBytes = canvasBits <= 8 ? 1 : canvasBits <= 16 ? 2 : 4;
+        if (3 * SCAN_BIT_DEPTH * NUM_ROWS * rowBytes + bytesPerPanel * panels <= SCAN_FRAME_BUDGET)
+        {
+            sramLimit = panels;
+        }
+    }
+
+    printf("Panel chain limit for %dx%d panels, %d bit planes\n", NUM_ROWS, Matrix::panelCols, SCAN_BIT_DEPTH);
+    printf("  SPI %u panels at %d Hz (shortest plane %u ticks, %u per panel), canvas width %u panels, SRAM %u panels\n",
+           spiLimit, SCAN_REFRESH_RATE, planeTicks, bytesPerPanel * 32, widthLimit, sramLimit);
+}
+
+#if SCAN_STATS
+static void readStats(uint16_t (&words)[9])
+{
+    uint8_t address = REG_STATS;
+    uint8_t reply[18] = {};
+    Wire.masterWrite(&address, 1);
+    Wire.masterRead(reply, sizeof(reply));
+
+    for (uint8_t i = 0; i < 9; i++)
+    {
+        words[i] = reply[2 * i] | reply[2 * i + 1] << 8;
+    }
+}
+
+// CPU use measured by the firmware itself over one second of scanning and rendering, as a controller polling the
+// panel would see it
+static void benchStats()
+{
+    uint16_t words[9];
+    readStats(words); // start a new window
+
+    // loop() runs once per scan interrupt, which wakes it from idle sleep
+    uint64_t ticks = 0;
+    unsigned long wakes = 0;
+    unsigned long sleeps = stub::sleeps;
+    uint32_t shown, dropped, startShown, startDropped;
+    scanReadFrameCounts(startShown, startDropped);
+    while (ticks < SCAN_TICK_HZ)
+    {
+        runScanIsr<Matrix>();
+        ticks += TCB0.CCMP.value + 1;
+
+        stub::nowMillis = ticks / (SCAN_TICK_HZ / 1000);
+        loop();
+        wakes++;
+    }
+    sleeps = stub::sleeps - sleeps;
+    scanReadFrameCounts(shown, dropped);
+    readStats(words);
+
+    printf("Stats (0x%02X), 1 s window, %lu loop passes, %lu idle sleeps, %lu frames rendered, %lu of them dropped\n",
+           REG_STATS, wakes, sleeps, (unsigned long)(shown - startShown + dropped - startDropped),
+           (unsigned long)(dropped - startDropped));
+    printf("  ISR min %.1f us, avg %.1f us, max %.1f us, max latency %.1f us, load %.1f%%\n", words[0] / 10.0,
+           words[1] / 10.0, words[2] / 10.0, words[3] / 10.0, words[7] / 10.0);
+    printf("  render min %u us, avg %u us, max %u us, load %.1f%%\n", words[4], words[5], words[6], words[8] / 10.0);
+}
+#endif
+
+// Refresh rates written to REG_REFRESH and the rates achieved, read back from REG_REFRESH_RATE
+static void benchRefreshRates()
+{
+    const uint16_t rates[] = {60, 120, 250, 500, 1000, 2000, SCAN_REFRESH_RATE};
+
+    printf("Refresh rates (0x%02X), %dx%d, %d bit planes, %d blank cycles\n", REG_REFRESH, NUM_ROWS, NUM_COLS,
+           SCAN_BIT_DEPTH, NUM_BLANK_CYCLES);
+    for (uint16_t rate : rates)
+    {
+        uint8_t packet[] = {REG_REFRESH, (uint8_t)rate, (uint8_t)(rate >> 8)};
+        uint8_t address = REG_REFRESH_RATE;
+        uint8_t reply[2] = {0, 0};
+        Wire.masterWrite(packet, sizeof(packet));
+        handleQueuedCommands();
+        Wire.masterWrite(&address, 1);
+        Wire.masterRead(reply, sizeof(reply));
+
+        uint16_t achieved = reply[0] | reply[1] << 8;
+        double isrRate = (double)SCAN_TICK_HZ / Matrix::rowPeriod * (SCAN_BIT_DEPTH + NUM_BLANK_CYCLES);
+        printf("  requested %4u Hz, achieved %4u Hz, plane %5u ticks, ISR rate %6.0f Hz\n", rate, achieved,
+               Matrix::planePeriod, isrRate);
+    }
+}
+
+static void benchI2cFrames()
+{
+    const uint8_t rowsPerWrite = (BUFFER_LENGTH - 1) / sizeof(rowdata_t);
+    uint8_t packet[BUFFER_LENGTH];
+    rowdata_t rowData = 0;
+
+    Wire.busBytes = 0;
+    Wire.transactions = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long frame = 0; frame < BENCH_I2C_FRAMES; frame++)
+    {
+        for (uint8_t row = 0; row < NUM_ROWS; row += rowsPerWrite)
+        {
+            // all but the last write of a frame are held so a half sent frame is never shown
+            uint8_t length = 0;
+            bool last = row + rowsPerWrite >= NUM_ROWS;
+            packet[length++] = (last ? REG_FRAME : REG_FRAME_HOLD) + row * sizeof(rowdata_t);
+            for (uint8_t i = row; i < NUM_ROWS && i < row + rowsPerWrite; i++)
+            {
+                rowData = (rowdata_t)(frame * NUM_ROWS + i);
+                for (uint8_t b = 0; b < sizeof(rowdata_t); b++)
+                {
+                    packet[length++] = (uint8_t)(rowData >> (8 * b));
+                }
+            }
+            Wire.masterWrite(packet, length);
+            handleQueuedCommands(); // loop() gets a turn between writes
+        }
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    // start, 9 clocks per byte including ACK, stop
+    const double bitsPerFrame = (Wire.busBytes * 9.0 + Wire.transactions * 2.0) / BENCH_I2C_FRAMES;
+    const double usPerFrame = std::chrono::duration<double, std::micro>(elapsed).count() / BENCH_I2C_FRAMES;
+    const bool lastFrameShown = Matrix::frameReady && Matrix::frames[Matrix::readyIndex][0][NUM_ROWS - 1] == rowData;
+
+    printf("I2C raw frames (0x%02X), %lu frames\n", REG_FRAME, BENCH_I2C_FRAMES);
+    printf("  %.1f writes, %.1f bus bytes per frame, last frame %s\n", (double)Wire.transactions / BENCH_I2C_FRAMES,
+           (double)Wire.busBytes / BENCH_I2C_FRAMES, lastFrameShown ? "shown" : "MISSING");
+    printf("  bus limit %.0f fps at 100kHz, %.0f fps at 400kHz\n", 100000.0 / bitsPerFrame, 400000.0 / bitsPerFrame);
+    printf("  host time %.2f us per frame handled\n", usPerFrame);
+}
+
+// a few adjacent rows, about a small sprite moving, in one write
+static void benchI2cDeltaFrames()
+{
+    rowdata_t expected[NUM_ROWS];
+    uint8_t packet[BUFFER_LENGTH];
+
+    // deltas build on whatever frame was shown last
+    memcpy(expected, Matrix::frames[scanLastIndex()][0], sizeof(expected));
+
+    Wire.busBytes = 0;
+    Wire.transactions = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long frame = 0; frame < BENCH_I2C_FRAMES; frame++)
+    {
+        // rows spread over the panel, as a sprite's changed rows are, so no one frame register write covers them
+        uint32_t rowMask = 0;
+        for (uint8_t i = 0; i < BENCH_DELTA_ROWS; i++)
+        {
+            rowMask |= (uint32_t)1 << (frame + i * NUM_ROWS / BENCH_DELTA_ROWS) % NUM_ROWS;
+        }
+
+        uint8_t length = 0;
+        packet[length++] = REG_DELTA;
+        for (uint8_t b = 0; b < DELTA_MASK_BYTES; b++)
+        {
+            packet[length++] = (uint8_t)(rowMask >> (8 * b));
+        }
+        for (uint8_t row = 0; row < NUM_ROWS; row++)
+        {
+            if (rowMask & ((uint32_t)1 << row))
+            {
+                expected[row] = (rowdata_t)(frame * 7 + row);
+                for (uint8_t b = 0; b < sizeof(rowdata_t); b++)
+                {
+                    packet[length++] = (uint8_t)(expected[row] >> (8 * b));
+                }
+            }
+        }
+        Wire.masterWrite(packet, length);
+        handleQueuedCommands();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    const double bitsPerFrame = (Wire.busBytes * 9.0 + Wire.transactions * 2.0) / BENCH_I2C_FRAMES;
+    const double usPerFrame = std::chrono::duration<double, std::micro>(elapsed).count() / BENCH_I2C_FRAMES;
+    const bool lastFrameShown = memcmp(Matrix::frames[scanLastIndex()][0], expected, sizeof(expected)) == 0;
+
+    printf("I2C delta frames (0x%02X), %d rows changed, %lu frames\n", REG_DELTA, BENCH_DELTA_ROWS, BENCH_I2C_FRAMES);
+    printf("  %.1f writes, %.1f bus bytes per frame, last frame %s\n", (double)Wire.transactions / BENCH_I2C_FRAMES,
+           (double)Wire.busBytes / BENCH_I2C_FRAMES, lastFrameShown ? "shown" : "MISSING");
+    printf("  bus limit %.0f fps at 100kHz, %.0f fps at 400kHz\n", 100000.0 / bitsPerFrame, 400000.0 / bitsPerFrame);
+    printf("  host time %.2f us per frame handled\n", usPerFrame);
+}
+
+// Telemetry registers after everything above, frames sent over I2C faster than the scan shows them are
+// counted as dropped
+static void benchTelemetry()
+{
+    uint8_t address = REG_FRAMES_SHOWN;
+    uint8_t reply[REG_REFRESH_RATE] = {};
+    Wire.masterWrite(&address, 1);
+    size_t length = Wire.masterRead(reply, REG_REFRESH_RATE - REG_FRAMES_SHOWN);
+
+    auto field = [&](uint8_t address, uint8_t size) {
+        uint32_t value = 0;
+        for (uint8_t i = 0; i < size; i++)
+        {
+            value |= (uint32_t)reply[address - REG_FRAMES_SHOWN + i] << (8 * i);
+        }
+        return (unsigned long)value;
+    };
+
+    printf("Telemetry, %u bytes from 0x%02X\n", (unsigned)length, REG_FRAMES_SHOWN);
+    printf("  frames shown %lu, dropped %lu, I2C messages %lu, truncated %lu, unmapped writes %lu, uptime %lu s, "
+           "queue overflows %lu\n",
+           field(REG_FRAMES_SHOWN, 4), field(REG_FRAMES_DROPPED, 4), field(REG_MESSAGES, 4), field(REG_TRUNCATED, 2),
+           field(REG_UNMAPPED_WRITES, 2), field(REG_UPTIME, 4), field(REG_QUEUE_OVERFLOWS, 2));
+
+    uint8_t switchState = 0xFF;
+    Wire.masterRead(&switchState, 1);
+    printf("  next one byte read %s\n", switchState == digitalRead(SWITCH_PIN) ? "is the switch state" : "WRONG");
+}
+
+static void benchTextRender()
+{
+    scrollTextSetMessage(BENCH_TEXT_MESSAGE);
+    const unsigned long framesPerCycle = scrollMessageWidth + MATRIX_WIDTH + 1;
+
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < BENCH_TEXT_CYCLES * framesPerCycle; i++)
+    {
+        scrollText();
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    printf("Text scroll, %d chars, %lu frames per cycle\n", (int)strlen(scrollMessage), framesPerCycle);
+    printf("  host time %.3f us per frame\n",
+           std::chrono::duration<double, std::micro>(elapsed).count() / (BENCH_TEXT_CYCLES * framesPerCycle));
+
+    // a row at a time, the same number of frames
+    scrollTextInvalidate();
+    start = std::chrono::steady_clock::now();
+    for (unsigned long i = 0; i < BENCH_TEXT_CYCLES * framesPerCycle; i++)
+    {
+        scrollTextVertical(1, false);
+    }
+    elapsed = std::chrono::steady_clock::now() - start;
+
+    printf("Vertical scroll, %d lines on screen, %d rows per line\n", SCROLL_LINES, SCROLL_LINE_PITCH);
+    printf("  host time %.3f us per frame\n",
+           std::chrono::duration<double, std::micro>(elapsed).count() / (BENCH_TEXT_CYCLES * framesPerCycle));
+}
+
+int main()
+{
+    setup();
+
+    benchScanIsr<Matrix>();
+#if SCAN_STATS
+    benchStats();
+#endif
+    benchOtherScanIsr<ScanMatrix<8, 8, 0>>();
+    benchOtherScanIsr<ScanMatrix<16, 16, 0>>();
+    benchOtherScanIsr<ScanMatrix<8, 32, 0>>();
+    benchOtherScanIsr<ScanMatrix<32, 8, 0>>();
+    benchOtherScanIsr<ScanMatrix<8, 8, 2>>();
+    benchOtherScanIsr<ScanMatrix<8, 8, 0, 2>>();
+    benchOtherScanIsr<ScanMatrix<8, 8, 0, 4>>();
+    benchOtherScanIsr<ScanMatrix<16, 16, 0, 2>>();
+    benchPanelLimit();
+    benchRefreshRates();
+    benchI2cFrames();
+    benchI2cDeltaFrames();
+    benchTelemetry();
+    benchTextRender();
+
+    return 0;
+}
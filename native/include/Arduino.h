@@ -0,0 +1,315 @@
+#pragma once
+
+// Host stand-ins for the parts of the megaTinyCore Arduino API and the
+// ATtiny817 register file used by the firmware. Only the native envs see
+// this header; hardware accesses are counted instead of performed.
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace stub
+{
+inline unsigned long pinWrites = 0;
+inline unsigned long regReads = 0;
+inline unsigned long regWrites = 0;
+inline unsigned long spiBytes = 0;
+inline unsigned long spiCalls = 0;
+inline unsigned long spiWaitPolls = 0; // SPI0.INTFLAGS reads made while a byte was still on the wire
+inline unsigned long nowMillis = 0;
+inline unsigned long timerStart = 0; // cycles() at the last TCB0 compare match
+
+// Rough megaTinyCore costs at 20 MHz, good for comparing revisions of the
+// ISR against each other rather than as absolute numbers
+#define CYCLES_ISR_OVERHEAD 40    // vector, prologue/epilogue, reti
+#define CYCLES_PIN_WRITE 60       // digitalWrite() with a runtime pin number
+#define CYCLES_REG_ACCESS 2       // lds/sts on an I/O register
+#define CYCLES_SPI_POLL 4         // one turn of a busy-wait on SPI0.INTFLAGS
+#define CYCLES_SPI_CALL 12        // SPI.transfer()/transfer16() call overhead
+
+// cycles spent on the counted operations, the clock TCB0 counts below
+inline unsigned long cycles()
+{
+    return pinWrites * CYCLES_PIN_WRITE + (regReads + regWrites) * CYCLES_REG_ACCESS +
+           spiWaitPolls * CYCLES_SPI_POLL + spiCalls * CYCLES_SPI_CALL;
+}
+
+inline void resetCounters()
+{
+    pinWrites = 0;
+    regReads = 0;
+    regWrites = 0;
+    spiBytes = 0;
+    spiCalls = 0;
+    spiWaitPolls = 0;
+    timerStart = 0;
+}
+
+// SPI0 wire model, bytes in the buffer/shift register drain one per
+// SPI_BYTE_POLLS flag reads, or all at once when the CPU is elsewhere
+#define SPI_BYTE_POLLS 16 // 64 cycles per byte at 2.5MHz, ~4 cycles per poll
+inline uint8_t spiInFlight = 0;
+inline uint8_t spiPolls = 0;
+
+inline void spiIdle()
+{
+    spiInFlight = 0;
+    spiPolls = 0;
+}
+} // namespace stub
+
+// I/O register that counts every access made through it
+template <typename T>
+struct StubReg
+{
+    T value;
+
+    operator T() const
+    {
+        stub::regReads++;
+        return value;
+    }
+
+    StubReg &operator=(T v)
+    {
+        stub::regWrites++;
+        value = v;
+        return *this;
+    }
+
+    StubReg &operator|=(T v) { return *this = (T)(*this | v); }
+    StubReg &operator&=(T v) { return *this = (T)(*this & v); }
+};
+
+typedef StubReg<uint8_t> register8_t;
+typedef StubReg<uint16_t> register16_t;
+
+#define SPI_BUFEN_bm 0x80
+#define SPI_IF_bm 0x80
+#define SPI_TXCIF_bm 0x40
+#define SPI_DREIF_bm 0x20
+#define SPI_TXCIE_bm 0x40
+#define SPI_DREIE_bm 0x20
+
+// SPI data register, a write puts one byte on the wire
+struct StubSpiData : register8_t
+{
+    StubSpiData &operator=(uint8_t v)
+    {
+        stub::spiBytes++;
+        stub::spiInFlight++;
+        register8_t::operator=(v);
+        return *this;
+    }
+};
+
+// SPI interrupt flags, driven by the wire model above
+struct StubSpiFlags
+{
+    operator uint8_t() const
+    {
+        stub::regReads++;
+        if (stub::spiInFlight == 0)
+            return SPI_IF_bm | SPI_TXCIF_bm | SPI_DREIF_bm;
+
+        stub::spiWaitPolls++;
+        if (++stub::spiPolls == SPI_BYTE_POLLS)
+        {
+            stub::spiPolls = 0;
+            stub::spiInFlight--;
+        }
+        return stub::spiInFlight < 2 ? SPI_DREIF_bm : 0;
+    }
+
+    StubSpiFlags &operator=(uint8_t)
+    {
+        stub::regWrites++;
+        return *this;
+    }
+};
+
+// SPI - Serial Peripheral Interface
+struct SPI_t
+{
+    register8_t CTRLA;
+    register8_t CTRLB;
+    register8_t INTCTRL;
+    StubSpiFlags INTFLAGS;
+    StubSpiData DATA;
+};
+
+inline SPI_t SPI0;
+
+// VPORT - Virtual Ports
+struct VPORT_t
+{
+    register8_t DIR;
+    register8_t OUT;
+    register8_t IN;
+    register8_t INTFLAGS;
+};
+
+inline VPORT_t VPORTA;
+inline VPORT_t VPORTB;
+inline VPORT_t VPORTC;
+
+#define PIN0_bm 0x01
+#define PIN1_bm 0x02
+#define PIN2_bm 0x04
+#define PIN3_bm 0x08
+#define PIN4_bm 0x10
+#define PIN5_bm 0x20
+#define PIN6_bm 0x40
+#define PIN7_bm 0x80
+
+// interrupt flags, writing a one clears the flag
+struct StubFlags : register8_t
+{
+    StubFlags &operator=(uint8_t v)
+    {
+        stub::regWrites++;
+        value &= ~v;
+        return *this;
+    }
+};
+
+// TCB0 counter, counts at F_CPU / 2 through the modelled cycles since the last compare match
+struct StubTimerCount : register16_t
+{
+    operator uint16_t() const
+    {
+        stub::regReads++;
+        return value + (stub::cycles() - stub::timerStart) / 2;
+    }
+};
+
+// TCB - 16-bit Timer/Counter Type B
+struct TCB_t
+{
+    register8_t CTRLA;
+    register8_t CTRLB;
+    register8_t EVCTRL;
+    register8_t INTCTRL;
+    StubFlags INTFLAGS;
+    register8_t STATUS;
+    register8_t DBGCTRL;
+    register8_t TEMP;
+    StubTimerCount CNT;
+    register16_t CCMP;
+};
+
+inline TCB_t TCB0;
+
+namespace stub
+{
+// TCB0 reaches CCMP, its interrupt starts entryTicks later
+inline void timerMatch(uint16_t entryTicks)
+{
+    TCB0.INTFLAGS.value |= 0x01;
+    TCB0.CNT.value = entryTicks;
+    timerStart = cycles();
+}
+} // namespace stub
+
+// TCA - 16-bit Timer/Counter Type A, split mode view only
+struct TCA_SPLIT_t
+{
+    register8_t CTRLA;
+    register8_t CTRLB;
+    register8_t CTRLC;
+    register8_t CTRLD;
+    register8_t CTRLECLR;
+    register8_t CTRLESET;
+    register8_t INTCTRL;
+    register8_t INTFLAGS;
+    register8_t LCNT;
+    register8_t HCNT;
+    register8_t LPER;
+    register8_t HPER;
+    register8_t LCMP0;
+    register8_t HCMP0;
+    register8_t LCMP1;
+    register8_t HCMP1;
+    register8_t LCMP2;
+    register8_t HCMP2;
+};
+
+struct TCA_t
+{
+    TCA_SPLIT_t SPLIT;
+};
+
+inline TCA_t TCA0;
+
+#define TCA_SPLIT_ENABLE_bm 0x01
+#define TCA_SPLIT_CLKSEL_DIV1_gc (0x00 << 1)
+#define TCA_SPLIT_SPLITM_bm 0x01
+#define TCA_SPLIT_HCMP2EN_bm 0x40
+
+// megaTinyCore: stop the core using TCA0 for analogWrite()
+inline void takeOverTCA0() {}
+
+struct PORTMUX_t
+{
+    register8_t CTRLA;
+    register8_t CTRLB;
+    register8_t CTRLC;
+    register8_t CTRLD;
+};
+
+inline PORTMUX_t PORTMUX;
+
+#define PORTMUX_TCA05_bm 0x20
+
+#define TCB_ENABLE_bm 0x01
+#define TCB_CLKSEL_CLKDIV2_gc (0x01 << 1)
+#define TCB_CNTMODE_INT_gc (0x00 << 0)
+#define TCB_CAPT_bm 0x01
+
+#define F_CPU 20000000UL
+
+// status register, only the interrupt flag matters here
+inline uint8_t SREG = 0x80;
+inline void cli()
+{
+    SREG &= ~0x80;
+    asm volatile("" ::: "memory");
+}
+inline void sei()
+{
+    asm volatile("" ::: "memory");
+    SREG |= 0x80;
+}
+
+#define ISR(vector) void vector()
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define pgm_read_ptr(addr) (*(void *const *)(addr))
+#define memcpy_P memcpy
+
+#define HIGH 0x1
+#define LOW 0x0
+#define INPUT 0x0
+#define OUTPUT 0x1
+#define INPUT_PULLUP 0x2
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) { stub::pinWrites++; }
+inline int digitalRead(uint8_t) { return HIGH; }
+
+inline unsigned long millis() { return stub::nowMillis; }
+inline unsigned long micros() { return stub::nowMillis * 1000; }
+inline void delay(unsigned long ms) { stub::nowMillis += ms; }
+inline void yield() {}
+
+inline long map(long x, long inMin, long inMax, long outMin, long outMax)
+{
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+template <typename T, typename L, typename H>
+inline T constrain(T x, L lo, H hi)
+{
+    return x < (T)lo ? (T)lo : (x > (T)hi ? (T)hi : x);
+}
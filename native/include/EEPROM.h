@@ -0,0 +1,39 @@
+#pragma once
+
+#include <Arduino.h>
+
+// megaTinyCore EEPROM library on the 128 bytes of the ATtiny817, counting the bytes actually written
+#ifndef E2END
+#define E2END 0x7F
+#endif
+
+namespace stub
+{
+inline unsigned long eepromWrites = 0;
+} // namespace stub
+
+class EEPROMClass
+{
+public:
+    uint8_t data[E2END + 1];
+
+    EEPROMClass() { clear(); }
+
+    uint8_t read(int index) { return data[index]; }
+    void write(int index, uint8_t value)
+    {
+        data[index] = value;
+        stub::eepromWrites++;
+    }
+    void update(int index, uint8_t value)
+    {
+        if (data[index] != value)
+            write(index, value);
+    }
+    uint16_t length() { return E2END + 1; }
+
+    // erased state
+    void clear() { memset(data, 0xFF, sizeof(data)); }
+};
+
+inline EEPROMClass EEPROM;
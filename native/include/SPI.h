@@ -0,0 +1,27 @@
+#pragma once
+
+#include <Arduino.h>
+
+class SPIClass
+{
+public:
+    void begin() {}
+
+    uint8_t transfer(uint8_t data)
+    {
+        stub::spiCalls++;
+        stub::spiBytes++;
+        stub::spiWaitPolls += SPI_BYTE_POLLS;
+        return data;
+    }
+
+    uint16_t transfer16(uint16_t data)
+    {
+        stub::spiCalls++;
+        stub::spiBytes += 2;
+        stub::spiWaitPolls += 2 * SPI_BYTE_POLLS;
+        return data;
+    }
+};
+
+inline SPIClass SPI;
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define BUFFER_LENGTH 32
+
+// Wire in slave mode, plus a simulated master on the other end of the bus
+class TwoWire
+{
+public:
+    void begin(uint8_t address) { this->address = address; }
+    void onReceive(void (*handler)(int)) { receiveHandler = handler; }
+    void onRequest(void (*handler)()) { requestHandler = handler; }
+
+    int available() { return rxLength - rxIndex; }
+    int read() { return rxIndex < rxLength ? rxBuffer[rxIndex++] : -1; }
+    int peek() { return rxIndex < rxLength ? rxBuffer[rxIndex] : -1; }
+
+    size_t write(uint8_t data)
+    {
+        if (txLength >= BUFFER_LENGTH)
+            return 0;
+        txBuffer[txLength++] = data;
+        return 1;
+    }
+
+    size_t write(const uint8_t *data, size_t length)
+    {
+        size_t written = 0;
+        while (written < length && write(data[written]))
+            written++;
+        return written;
+    }
+
+    // master writes a transaction to this slave, returns bytes accepted
+    size_t masterWrite(const uint8_t *data, size_t length)
+    {
+        rxLength = length < BUFFER_LENGTH ? length : BUFFER_LENGTH;
+        rxIndex = 0;
+        memcpy(rxBuffer, data, rxLength);
+        busBytes += rxLength + 1; // plus address byte
+        transactions++;
+        if (receiveHandler)
+            receiveHandler(rxLength);
+        return rxLength;
+    }
+
+    // master reads up to length bytes from this slave, returns bytes read
+    size_t masterRead(uint8_t *data, size_t length)
+    {
+        txLength = 0;
+        if (requestHandler)
+            requestHandler();
+        size_t count = length < txLength ? length : txLength;
+        memcpy(data, txBuffer, count);
+        busBytes += length + 1;
+        transactions++;
+        return count;
+    }
+
+    uint8_t address = 0;
+    unsigned long busBytes = 0;
+    unsigned long transactions = 0;
+
+private:
+    void (*receiveHandler)(int) = nullptr;
+    void (*requestHandler)() = nullptr;
+    uint8_t rxBuffer[BUFFER_LENGTH];
+    uint8_t rxLength = 0;
+    uint8_t rxIndex = 0;
+    uint8_t txBuffer[BUFFER_LENGTH];
+    uint8_t txLength = 0;
+};
+
+inline TwoWire Wire;
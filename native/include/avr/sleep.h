@@ -0,0 +1,16 @@
+#pragma once
+
+#include <Arduino.h>
+
+// avr-libc sleep API, a sleep returns straight away as if the next interrupt had woken it
+#define SLEEP_MODE_IDLE 0x00
+
+namespace stub
+{
+inline unsigned long sleeps = 0;
+} // namespace stub
+
+inline void set_sleep_mode(uint8_t) {}
+inline void sleep_enable() {}
+inline void sleep_disable() {}
+inline void sleep_cpu() { stub::sleeps++; }
@@ -0,0 +1,3 @@
+#pragma once
+
+// main.cpp includes tinyNeoPixel but does not use it
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <Adafruit_GFX.h>
+
+// Adafruit GFX fonts repacked at compile time into fixed size cells, one column per byte (a word for fonts taller than
+// 8 rows) with bit n set for row n of the cell. Glyph c starts at column (c - first) * width, so fetching a glyph column
+// is one PROGMEM read, and the GFX bitmap and glyph tables are only used by the compiler and never reach flash.
+//
+//   typedef PACKED_FONT(Picopixel) font_t;
+//   constexpr font_t FONT PROGMEM = packFont<font_t>(Picopixel);
+
+template <bool Byte>
+struct PackedFontColumn
+{
+  typedef uint16_t type;
+};
+
+template <>
+struct PackedFontColumn<true>
+{
+  typedef uint8_t type;
+};
+
+template <uint8_t First, uint8_t Count, int8_t Left, int8_t Top, uint8_t Width, uint8_t Height, uint8_t YAdvance>
+struct PackedFont
+{
+  static_assert(Height <= 16, "packed font cells are at most 16 rows");
+
+  typedef typename PackedFontColumn<(Height <= 8)>::type column_t;
+
+  static constexpr uint8_t first = First;
+  static constexpr uint8_t count = Count;
+  static constexpr int8_t left = Left; // cell origin from the cursor
+  static constexpr int8_t top = Top;   // cell origin from the baseline
+  static constexpr uint8_t width = Width;
+  static constexpr uint8_t height = Height;
+  static constexpr uint8_t yAdvance = YAdvance;
+
+  column_t columns[Count * Width];
+  uint8_t widths[Count]; // xAdvance
+};
+
+// cell bounds over all glyphs with any pixels
+
+constexpr uint8_t fontCount(const GFXfont &font)
+{
+  return font.last - font.first + 1;
+}
+
+constexpr int8_t fontLeft(const GFXfont &font)
+{
+  int8_t left = 0;
+  for (uint8_t i = 0; i < fontCount(font); i++)
+  {
+    const GFXglyph &glyph = font.glyph[i];
+    if (glyph.width && glyph.height && glyph.xOffset < left)
+      left = glyph.xOffset;
+  }
+  return left;
+}
+
+constexpr int8_t fontTop(const GFXfont &font)
+{
+  int8_t top = 0;
+  for (uint8_t i = 0; i < fontCount(font); i++)
+  {
+    const GFXglyph &glyph = font.glyph[i];
+    if (glyph.width && glyph.height && glyph.yOffset < top)
+      top = glyph.yOffset;
+  }
+  return top;
+}
+
+constexpr uint8_t fontWidth(const GFXfont &font)
+{
+  int8_t right = fontLeft(font) + 1;
+  for (uint8_t i = 0; i < fontCount(font); i++)
+  {
+    const GFXglyph &glyph = font.glyph[i];
+    if (glyph.width && glyph.height && glyph.xOffset + glyph.width > right)
+      right = glyph.xOffset + glyph.width;
+  }
+  return right - fontLeft(font);
+}
+
+constexpr uint8_t fontHeight(const GFXfont &font)
+{
+  int8_t bottom = fontTop(font) + 1;
+  for (uint8_t i = 0; i < fontCount(font); i++)
+  {
+    const GFXglyph &glyph = font.glyph[i];
+    if (glyph.width && glyph.height && glyph.yOffset + glyph.height > bottom)
+      bottom = glyph.yOffset + glyph.height;
+  }
+  return bottom - fontTop(font);
+}
+
+#define PACKED_FONT(font) \
+  PackedFont<(font).first, fontCount(font), fontLeft(font), fontTop(font), fontWidth(font), fontHeight(font), \
+             (font).yAdvance>
+
+template <typename Packed>
+constexpr Packed packFont(const GFXfont &font)
+{
+  Packed packed{};
+  for (uint8_t i = 0; i < Packed::count; i++)
+  {
+    const GFXglyph &glyph = font.glyph[i];
+    packed.widths[i] = glyph.xAdvance;
+
+    uint16_t bit = glyph.bitmapOffset * 8;
+    for (uint8_t yy = 0; yy < glyph.height; yy++)
+    {
+      for (uint8_t xx = 0; xx < glyph.width; xx++, bit++)
+      {
+        if (font.bitmap[bit >> 3] & (0x80 >> (bit & 7)))
+        {
+          packed.columns[i * Packed::width + glyph.xOffset - Packed::left + xx] |=
+              (typename Packed::column_t)(1 << (glyph.yOffset - Packed::top + yy));
+        }
+      }
+    }
+  }
+  return packed;
+}
+
+inline uint8_t pgmReadColumn(const uint8_t *column)
+{
+  return pgm_read_byte(column);
+}
+
+inline uint16_t pgmReadColumn(const uint16_t *column)
+{
+  return pgm_read_word(column);
+}
+
+template <typename Packed>
+uint8_t packedCharWidth(const Packed &font, unsigned char c)
+{
+  uint8_t i = c - Packed::first;
+  return i < Packed::count ? pgm_read_byte(&font.widths[i]) : 0;
+}
+
+// column col of the cell for c, bit n set for row n of the cell
+template <typename Packed>
+typename Packed::column_t packedCharColumn(const Packed &font, unsigned char c, uint8_t col)
+{
+  uint8_t i = c - Packed::first;
+  return (i < Packed::count && col < Packed::width) ? pgmReadColumn(&font.columns[i * Packed::width + col]) : 0;
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Multi-frame sprite animations delta compressed at compile time. Each frame keeps only the rows that differ from the
+// frame before it, the first frame from a blank one, so a mostly still sprite costs a few bytes a frame in flash and
+// the player decodes straight into the draw buffer without a frame of its own. The source frames are only used by
+// the compiler and never reach flash.
+//
+//   constexpr SpriteFrame<8> heartFrames[] = {{400, {"..#..#..", ...}}, ...};
+//   typedef PACKED_SPRITE(heartFrames) heart_t;
+//   constexpr heart_t HEART PROGMEM = packSprite<heart_t>(heartFrames);
+//
+// Packed frame: duration in 10ms units, row mask with bit n for row n, then the changed rows, little-endian with bit
+// n for column n like rowdata_t.
+
+template <uint8_t Rows>
+struct SpriteFrame
+{
+  uint16_t duration;      // ms
+  const char *rows[Rows]; // '#' lights a pixel
+};
+
+template <uint8_t Rows, uint8_t Width, uint8_t Frames, uint16_t Size, bool DurationsFit = true>
+struct PackedSprite
+{
+  static_assert(Rows >= 1 && Rows <= 32 && Width >= 1 && Width <= 32, "sprites are at most 32 x 32");
+  static_assert(DurationsFit, "frame durations are at most 2550 ms, they are stored in 10ms units in a byte");
+
+  static constexpr uint8_t rows = Rows;
+  static constexpr uint8_t width = Width;
+  static constexpr uint8_t frames = Frames;
+  static constexpr uint8_t rowBytes = (Width + 7) / 8;
+  static constexpr uint8_t maskBytes = (Rows + 7) / 8;
+
+  uint8_t data[Size];
+};
+
+template <uint8_t Rows, size_t Frames>
+constexpr uint8_t spriteRows(const SpriteFrame<Rows> (&)[Frames])
+{
+  return Rows;
+}
+
+template <uint8_t Rows, size_t Frames>
+constexpr uint8_t spriteWidth(const SpriteFrame<Rows> (&frames)[Frames])
+{
+  uint8_t width = 0;
+  while (frames[0].rows[0][width])
+    width++;
+  return width;
+}
+
+template <uint8_t Rows>
+constexpr uint32_t spriteRow(const SpriteFrame<Rows> &frame, uint8_t row)
+{
+  uint32_t bits = 0;
+  for (uint8_t x = 0; frame.rows[row][x]; x++)
+  {
+    if (frame.rows[row][x] == '#')
+      bits |= (uint32_t)1 << x;
+  }
+  return bits;
+}
+
+// row of frame f as the frame before it left it, blank before the first
+template <uint8_t Rows>
+constexpr uint32_t spritePreviousRow(const SpriteFrame<Rows> *frames, size_t f, uint8_t row)
+{
+  return f ? spriteRow(frames[f - 1], row) : 0;
+}
+
+template <uint8_t Rows, size_t Frames>
+constexpr uint16_t spriteSize(const SpriteFrame<Rows> (&frames)[Frames])
+{
+  uint16_t size = 0;
+  for (size_t f = 0; f < Frames; f++)
+  {
+    size += 1 + (Rows + 7) / 8;
+    for (uint8_t row = 0; row < Rows; row++)
+    {
+      if (spriteRow(frames[f], row) != spritePreviousRow(frames, f, row))
+        size += (spriteWidth(frames) + 7) / 8;
+    }
+  }
+  return size;
+}
+
+// true if every duration rounds to a byte of 10ms units
+template <uint8_t Rows, size_t Frames>
+constexpr bool spriteDurationsFit(const SpriteFrame<Rows> (&frames)[Frames])
+{
+  for (size_t f = 0; f < Frames; f++)
+  {
+    if ((frames[f].duration + 5) / 10 > 255)
+      return false;
+  }
+  return true;
+}
+
+#define PACKED_SPRITE(frames)                                                                                  \
+  PackedSprite<spriteRows(frames), spriteWidth(frames), sizeof(frames) / sizeof((frames)[0]), spriteSize(frames), \
+               spriteDurationsFit(frames)>
+
+template <typename Packed, uint8_t Rows, size_t Frames>
+constexpr Packed packSprite(const SpriteFrame<Rows> (&frames)[Frames])
+{
+  static_assert(Rows == Packed::rows && Frames == Packed::frames, "packSprite() needs the frames its type was made from");
+
+  Packed packed{};
+  uint16_t i = 0;
+  for (size_t f = 0; f < Frames; f++)
+  {
+    packed.data[i++] = (frames[f].duration + 5) / 10;
+
+    uint32_t mask = 0;
+    for (uint8_t row = 0; row < Rows; row++)
+    {
+      if (spriteRow(frames[f], row) != spritePreviousRow(frames, f, row))
+        mask |= (uint32_t)1 << row;
+    }
+    for (uint8_t b = 0; b < Packed::maskBytes; b++)
+    {
+      packed.data[i++] = (uint8_t)(mask >> (8 * b));
+    }
+
+    for (uint8_t row = 0; row < Rows; row++)
+    {
+      if (mask & ((uint32_t)1 << row))
+      {
+        for (uint8_t b = 0; b < Packed::rowBytes; b++)
+        {
+          packed.data[i++] = (uint8_t)(spriteRow(frames[f], row) >> (8 * b));
+        }
+      }
+    }
+  }
+  return packed;
+}
+
+// a packed sprite without its type, for tables of animations with different sizes
+struct SpriteAnimation
+{
+  const uint8_t *data; // PROGMEM, unused for the upload in EEPROM
+  uint8_t rows;
+  uint8_t width;
+  uint8_t frames;
+  bool eeprom;
+};
+
+template <typename Packed>
+constexpr SpriteAnimation spriteAnimation(const Packed &sprite)
+{
+  return {sprite.data, Packed::rows, Packed::width, Packed::frames, false};
+}
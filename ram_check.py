@@ -0,0 +1,40 @@
+# PlatformIO post script, fails the build when the linked firmware leaves less than RAM_STACK_RESERVE bytes of SRAM
+# for the stack. avr-size counts every static byte the linker placed, the firmware's globals and Wire's and the
+# core's alike, so nothing a header estimate leaves out can push the stack into the globals unnoticed.
+#
+#   extra_scripts = post:ram_check.py
+
+import subprocess
+
+Import("env")
+
+# Stack the static data has to leave free, worked out from avr-gcc's frames for the deepest paths. It has not been
+# measured yet, REG_STACK_FREE reads the low-water mark off a running panel to check it against.
+#   loop()'s deepest path, about 100 bytes: a queued write showing a temporary message down to the glyph drawing, or
+#   a vertical scroll pass with its rows[NUM_ROWS] (32 bytes on 16 and 32 row panels) down to the word wrap
+#   the TWI interrupt on top of it, about 95 bytes: 17 for its register save and return address, 12 for Wire's
+#   handler frames, 46 for handleOnRequest() with its ScanStats (18) and frame counts (8), 20 for the calls it makes
+# The scan interrupt needs less and never nests with the TWI one.
+RAM_STACK_RESERVE = 192
+
+
+def ram_check(source, target, env):
+    ram_size = int(env.BoardConfig().get("upload.maximum_ram_size", 512))
+    output = subprocess.check_output([env.subst("$SIZETOOL"), "-A", str(target[0])]).decode()
+
+    used = 0
+    for line in output.splitlines():
+        fields = line.split()
+        if len(fields) >= 2 and fields[0] in (".data", ".bss", ".noinit"):
+            used += int(fields[1])
+
+    limit = ram_size - RAM_STACK_RESERVE
+    print("RAM check: %d bytes static, %d allowed, %d left for the stack" % (used, limit, ram_size - used))
+    if used > limit:
+        print("RAM check: static data is %d bytes over, use fewer panels, a lower SCAN_BIT_DEPTH or -DSCAN_STATS=0"
+              % (used - limit))
+        return 1
+    return 0
+
+
+env.AddPostAction("$BUILD_DIR/${PROGNAME}.elf", ram_check)
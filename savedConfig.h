@@ -0,0 +1,237 @@
+#pragma once
+
+#include <EEPROM.h>
+
+// Settings kept in EEPROM across power cycles. The settings go round a ring of CONFIG_SLOTS slots, each save to the
+// slot after the newest one with the next sequence number, so one slot sees a quarter of the writes. The scroll
+// message has two areas after the slots, a flag in each slot says which one goes with it. A new message goes into
+// the area the newest slot does not use and the slot goes last with its check byte, so a save cut short by a power
+// loss leaves the slot before it and its message whole. Saves wait for the settings to stay the same for
+// CONFIG_SAVE_DELAY, so a host setting the mode or speed many times a second costs one save, go one byte a loop()
+// pass with only bytes that differ written, and are skipped when nothing changed. The message changes far less
+// often and is saved at most once per CONFIG_MESSAGE_INTERVAL, a newer one waits while the settings go on saving.
+// The uploaded animation has its own area between the slots and the messages, spriteAnim.h writes it.
+#define CONFIG_SLOTS 4
+#define CONFIG_SLOT_SIZE 8
+#define CONFIG_UPLOAD_ADDRESS (CONFIG_SLOTS * CONFIG_SLOT_SIZE)
+#define CONFIG_UPLOAD_SIZE 48 // a full 32x8 frame and its header take 41 with the length byte
+#define CONFIG_MESSAGE_ADDRESS (CONFIG_UPLOAD_ADDRESS + CONFIG_UPLOAD_SIZE)
+#define CONFIG_MESSAGE_SIZE ((E2END + 1 - CONFIG_MESSAGE_ADDRESS) / 2) // longer messages come back cut short
+#define CONFIG_SAVE_DELAY 5000                                        // ms without changes before a save
+#define CONFIG_SAVE_MAX_DELAY 600000UL                                // ms a host changing settings nonstop waits
+#define CONFIG_MESSAGE_INTERVAL 600000UL                              // ms between message saves
+
+// SavedConfig flags
+#define CONFIG_DISPLAY 0x01      // display on
+#define CONFIG_MESSAGE_AREA 0x02 // message in the second area
+
+struct SavedConfig
+{
+  uint16_t updateInterval;
+  uint8_t sequence;
+  uint8_t flags;
+  uint8_t mode;
+  uint8_t animation;
+  uint8_t brightness;
+  uint8_t check;
+};
+static_assert(sizeof(SavedConfig) == CONFIG_SLOT_SIZE, "SavedConfig must fill a slot");
+
+SavedConfig configWriting;             // slot being written
+const char *configSaveMessage;         // message being written, nullptr if the save keeps the one saved
+uint8_t configSlot = CONFIG_SLOTS - 1; // newest slot, the first save goes to slot 0
+int16_t configSaveIndex = -1;          // next byte of the save, message then slot, -1 when there is none
+bool configDirty = false;
+uint16_t configChangeTime = 0;         // low bits of millis(), CONFIG_SAVE_DELAY is a few seconds
+unsigned long configDirtyTime = 0;
+bool configMessageSaved = false;       // a message save finished since power on, at configMessageTime
+unsigned long configMessageTime = 0;
+
+// erased EEPROM reads 0xFF, which never has a matching check byte, the seed changes with the layout so slots saved
+// by a firmware with another one are ignored
+uint8_t configCheck(const SavedConfig &config)
+{
+  const uint8_t *bytes = (const uint8_t *)&config;
+  uint8_t check = 0x5B;
+  for (uint8_t i = 0; i < CONFIG_SLOT_SIZE - 1; i++)
+  {
+    check = (check << 1 | check >> 7) ^ bytes[i];
+  }
+  return check;
+}
+
+bool configReadSlot(uint8_t slot, SavedConfig &config)
+{
+  uint8_t *bytes = (uint8_t *)&config;
+  for (uint8_t i = 0; i < CONFIG_SLOT_SIZE; i++)
+  {
+    bytes[i] = EEPROM.read(slot * CONFIG_SLOT_SIZE + i);
+  }
+  return config.check == configCheck(config);
+}
+
+uint16_t configMessageAddress(uint8_t flags)
+{
+  return CONFIG_MESSAGE_ADDRESS + (flags & CONFIG_MESSAGE_AREA ? CONFIG_MESSAGE_SIZE : 0);
+}
+
+// true if the area at address holds message as a save would leave it
+bool configMessageSame(uint16_t address, const char *message)
+{
+  for (uint8_t i = 0; i < CONFIG_MESSAGE_SIZE - 1; i++)
+  {
+    char saved = EEPROM.read(address + i);
+    if (saved != message[i])
+    {
+      return false;
+    }
+    if (saved == '\0')
+    {
+      break;
+    }
+  }
+  return true;
+}
+
+// reads the newest saved settings and message (CONFIG_MESSAGE_SIZE bytes), returns false if nothing was ever saved
+bool configLoad(SavedConfig &config, char *message)
+{
+  // the newest slot is the valid one not followed by its next sequence number
+  bool found = false;
+  for (uint8_t slot = 0; slot < CONFIG_SLOTS && !found; slot++)
+  {
+    SavedConfig next;
+    if (configReadSlot(slot, config) &&
+        !(configReadSlot((slot + 1) % CONFIG_SLOTS, next) && next.sequence == (uint8_t)(config.sequence + 1)))
+    {
+      configSlot = slot;
+      found = true;
+    }
+  }
+  if (!found)
+  {
+    return false;
+  }
+
+  const uint16_t address = configMessageAddress(config.flags);
+  for (uint8_t i = 0; i < CONFIG_MESSAGE_SIZE; i++)
+  {
+    message[i] = EEPROM.read(address + i);
+  }
+  message[CONFIG_MESSAGE_SIZE - 1] = '\0';
+  return true;
+}
+
+// marks the settings changed, an unfinished save starts over once they settle
+void configChanged()
+{
+  unsigned long now = millis();
+  if (!configDirty)
+  {
+    configDirty = true;
+    configDirtyTime = now;
+  }
+  configChangeTime = now;
+  configSaveIndex = -1;
+}
+
+// true once changed settings have settled, or have waited long enough
+bool configSaveDue()
+{
+  unsigned long now = millis();
+  return configDirty &&
+         ((uint16_t)(now - configChangeTime) >= CONFIG_SAVE_DELAY || now - configDirtyTime >= CONFIG_SAVE_MAX_DELAY);
+}
+
+// starts saving config and message, message must not change until the save is done
+void configSaveBegin(const SavedConfig &config, const char *message)
+{
+  SavedConfig newest;
+  const bool found = configReadSlot(configSlot, newest);
+  configWriting = config;
+  configWriting.flags = (config.flags & ~CONFIG_MESSAGE_AREA) | (found ? newest.flags & CONFIG_MESSAGE_AREA : 0);
+  configSaveMessage = nullptr;
+  configDirty = false;
+
+  if (!found || !configMessageSame(configMessageAddress(configWriting.flags), message))
+  {
+    unsigned long now = millis();
+    if (!found || !configMessageSaved || now - configMessageTime >= CONFIG_MESSAGE_INTERVAL)
+    {
+      // into the other area, the newest slot keeps its message until this one is whole
+      configWriting.flags ^= CONFIG_MESSAGE_AREA;
+      configSaveMessage = message;
+    }
+    else
+    {
+      // the settings go now, the message tries again once they have settled
+      configDirty = true;
+      configChangeTime = now;
+      configDirtyTime = now;
+    }
+  }
+
+  configWriting.sequence = newest.sequence;
+  configWriting.check = newest.check;
+  if (found && configSaveMessage == nullptr && memcmp(&configWriting, &newest, CONFIG_SLOT_SIZE) == 0)
+  {
+    configSaveIndex = -1; // nothing changed
+    return;
+  }
+  configWriting.sequence = newest.sequence + 1;
+  configWriting.check = configCheck(configWriting);
+  configSaveIndex = configSaveMessage != nullptr ? 0 : CONFIG_MESSAGE_SIZE;
+}
+
+bool configSaveBusy()
+{
+  return configSaveIndex >= 0;
+}
+
+// writes the next byte of the save that differs from the EEPROM
+void configSaveStep()
+{
+  const uint8_t slot = (configSlot + 1) % CONFIG_SLOTS;
+  const uint16_t messageAddress = configMessageAddress(configWriting.flags);
+  const char *message = configSaveMessage;
+  const uint8_t messageLength = message != nullptr ? strnlen(message, CONFIG_MESSAGE_SIZE - 1) : 0;
+  while (configSaveIndex >= 0)
+  {
+    uint16_t address;
+    uint8_t value;
+    if (configSaveIndex < CONFIG_MESSAGE_SIZE)
+    {
+      // the bytes after the terminator are left as they are
+      if (configSaveIndex > messageLength)
+      {
+        configSaveIndex = CONFIG_MESSAGE_SIZE;
+        continue;
+      }
+      address = messageAddress + configSaveIndex;
+      value = configSaveIndex < messageLength ? message[configSaveIndex] : '\0';
+    }
+    else if (configSaveIndex < CONFIG_MESSAGE_SIZE + CONFIG_SLOT_SIZE)
+    {
+      address = slot * CONFIG_SLOT_SIZE + configSaveIndex - CONFIG_MESSAGE_SIZE;
+      value = ((const uint8_t *)&configWriting)[configSaveIndex - CONFIG_MESSAGE_SIZE];
+    }
+    else
+    {
+      configSlot = slot;
+      configSaveIndex = -1;
+      if (message != nullptr)
+      {
+        configMessageSaved = true;
+        configMessageTime = millis();
+      }
+      return;
+    }
+
+    configSaveIndex++;
+    if (EEPROM.read(address) != value)
+    {
+      EEPROM.write(address, value);
+      return;
+    }
+  }
+}
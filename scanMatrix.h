@@ -4,136 +4,651 @@
 #include <SPI.h>
 
 // Pin definitions
-#define LATCH_PIN 16 // RCLK/STB
-#define OE_PIN 17    // !OE, can be tied to GND if need to save pin
+#define LATCH_PIN 16 // RCLK/STB (PC4)
+#define OE_PIN 17    // !OE (PC5), driven by TCA0 WO5 for brightness, can be tied to GND if need to save pin
 // #define DATA_PIN 18   // MOSI/IN
 // #define CLOCK_PIN 20  // SCLK/CLK
 
-// Matrix size and type configuration based on build flags
-#if defined(MATRIX_16X16)
-#define NUM_ROWS 16
-#define NUM_COLS 16
-#define NUM_LEDS 256
-#define NUM_BLANK_CYCLES 0
-#define BLANK_DATA 0xFFFF
-typedef uint16_t rowdata_t;
-#elif defined(MATRIX_8X8)
-#define NUM_ROWS 8
-#define NUM_COLS 8
-#define NUM_LEDS 64
-#define NUM_BLANK_CYCLES 2
-#define BLANK_DATA 0xFF
-typedef uint8_t rowdata_t;
-#else
-#error "No matrix size defined. Use -DMATRIX_8X8 or -DMATRIX_16X16"
+// LATCH_PIN through its virtual port, so the ISR can pulse it with single cycle sbi/cbi
+#define LATCH_VPORT VPORTC
+#define LATCH_PIN_bm PIN4_bm
+
+// Matrix size from build flags, e.g. -DMATRIX_ROWS=16 -DMATRIX_COLS=16, MATRIX_PANELS panels of that size can be
+// chained on the same SPI and latch to make one wider canvas. A chain has to keep its three frames within
+// SCAN_FRAME_BUDGET, which only 8-row panels do: 8x8 x2 at two bit planes or x4 at one. Two 16x16 panels would take
+// 192 bytes of frames at one plane and 64 byte frames, twice the frame register window.
+#if !defined(MATRIX_ROWS) || !defined(MATRIX_COLS)
+#error "No matrix size defined. Use -DMATRIX_ROWS=<rows> -DMATRIX_COLS=<cols>"
+#endif
+#ifndef MATRIX_PANELS
+#define MATRIX_PANELS 1
+#endif
+#ifndef MATRIX_BLANK_CYCLES
+#define MATRIX_BLANK_CYCLES 0
+#endif
+#ifndef DEFAULT_BRIGHTNESS
+#define DEFAULT_BRIGHTNESS 85
 #endif
 
-#define MATRIX_HEIGHT NUM_ROWS
-#define MATRIX_WIDTH NUM_COLS
+// Grayscale depth, each pixel level is split into SCAN_BIT_DEPTH bit planes shown with Binary Code Modulation. The
+// three frames of triple buffering take SCAN_BIT_DEPTH planes each, and within SCAN_FRAME_BUDGET two planes only fit
+// 8x8 panels, one or two chained. Grayscale is 8x8-only: the other geometries build with -DSCAN_BIT_DEPTH=1, where
+// scanSetPixelLevel() levels above zero all show fully on.
+#ifndef SCAN_BIT_DEPTH
+#define SCAN_BIT_DEPTH 2
+#endif
+#if SCAN_BIT_DEPTH < 1 || SCAN_BIT_DEPTH > 4
+#error "SCAN_BIT_DEPTH must be between 1 and 4"
+#endif
+#define SCAN_MAX_LEVEL ((1 << SCAN_BIT_DEPTH) - 1)
 
-// draw variables
-rowdata_t drawBuffer[NUM_ROWS];             // draw updates go here
-volatile rowdata_t displayBuffer[NUM_ROWS]; // ISR shifts out data from this, copies new data from drawBuffer
+// Scan timing, TCB0 counts at SCAN_TICK_HZ and the row and plane periods are worked out from the refresh rate,
+// so every geometry shows the same number of frames per second, scanSetRefreshRate() changes it at runtime
+#define SCAN_TICK_HZ (F_CPU / 2)
+#ifndef SCAN_REFRESH_RATE
+#define SCAN_REFRESH_RATE 250 // Hz
+#endif
 
-// ISR state variables
-volatile bool bufferUpdate = false; // flag to signal ISR that buffer needs to change/be updated
-volatile uint8_t curLine = 0;
-volatile uint8_t blankCycles = 0; // off cycles between each line write
-bool displayEnabled;
+// Brightness is the duty cycle of !OE, generated by TCA0 in split mode on the high half compare 2 (WO5),
+// counting from 20MHz for a ~78kHz PWM well above the row rate
+#define BRIGHTNESS_PWM_PERIOD 254
+#define BRIGHTNESS_FADE_STEP 8 // brightness change per frame when fading on/off
 
-void scanClear()
-{
-    for (int i = 0; i < NUM_ROWS; i++)
-    {
-        drawBuffer[i] = 0;
-    }
-}
+// CPU time accounting for the scan ISRs and the render passes, read with scanReadStats(). It takes 32 bytes of SRAM
+// and is built in so every panel can report it, -DSCAN_STATS=0 leaves it out
+#ifndef SCAN_STATS
+#define SCAN_STATS 1
+#endif
+#define SCAN_TICKS_PER_US (SCAN_TICK_HZ / 1000000)
 
-void scanDisplay(bool enabled)
-{
-    displayEnabled = enabled;
-    digitalWrite(OE_PIN, !displayEnabled);
-}
+// SRAM the frame buffers may take, the one allocation that grows with the geometry. This is its only limit, the
+// whole linked image is checked against the 512 bytes by ram_check.py
+#define SCAN_FRAME_BUDGET 128
 
-void scanInit()
+// smallest unsigned type holding Bits bits, the shift register chain width for a row of data or row select
+template <bool Fits8, bool Fits16>
+struct UintSelect
 {
-    pinMode(OE_PIN, OUTPUT);
-    pinMode(LATCH_PIN, OUTPUT);
-    digitalWrite(OE_PIN, LOW);
-    digitalWrite(LATCH_PIN, LOW);
-
-    SPI.begin();
-
-    // Configure Timer B (TCA0) for CTC mode at 8kHz from 10MHz
-    TCB0.CTRLA = TCB_ENABLE_bm | TCB_CLKSEL_CLKDIV2_gc;
-    TCB0.CTRLB = TCB_CNTMODE_INT_gc; // CTC mode
-    TCB0.CCMP = 1249 * 2;            // (20Mhz / 2) / 1250 = 8kHz
-    TCB0.INTCTRL = TCB_CAPT_bm;      // Enable interrupt on capture
-}
+    typedef uint32_t type;
+};
 
-void scanSetPixel(int x, int y, bool on)
+template <bool Fits16>
+struct UintSelect<true, Fits16>
 {
-    if (x < 0 || x >= NUM_COLS || y < 0 || y >= NUM_ROWS)
-        return;
+    typedef uint8_t type;
+};
 
-    if (on)
-        drawBuffer[y] |= (1 << x);
-    else
-        drawBuffer[y] &= ~(1 << x);
-}
+template <>
+struct UintSelect<false, true>
+{
+    typedef uint16_t type;
+};
 
-void scanSetRow(uint8_t row, rowdata_t rowData) {
-    drawBuffer[row] = rowData;
-}
+template <uint8_t Bits>
+struct UintFor : UintSelect<(Bits <= 8), (Bits <= 16)>
+{
+    static_assert(Bits >= 1 && Bits <= 32, "matrix rows and canvas columns must be between 1 and 32");
+};
 
-void scanShow()
+// CPU use since the previous scanReadStats(), times in TCB0 ticks (0.1us) unless noted, loads in 0.1%
+struct ScanStats
 {
-    bufferUpdate = true;
-}
+    uint16_t isrMin; // TCB0 ISR from the compare match to its return
+    uint16_t isrAvg;
+    uint16_t isrMax;
+    uint16_t latencyMax; // compare match to the first ISR instruction
+    uint16_t renderMin;  // us
+    uint16_t renderAvg;  // us
+    uint16_t renderMax;  // us
+    uint16_t isrLoad;    // TCB0 and SPI0 ISRs
+    uint16_t renderLoad;
+};
 
-ISR(TCB0_INT_vect)
+// Scan engine for Panels chained Rows x Cols matrices, with BlankCycles off rows after each lit row. The panels form
+// one canvas Cols * Panels wide, panel 0 on the left. The ISRs drive the one TCB0, SPI0 and TCA0, so a build uses a
+// single geometry (Matrix below), other instantiations are for the native bench.
+template <uint8_t Rows, uint8_t Cols, uint8_t BlankCycles, uint8_t Panels = 1>
+class ScanMatrix
 {
-    // clear interrupt flag
-    TCB0.INTFLAGS = TCB_CAPT_bm;
+public:
+    typedef typename UintFor<Cols * Panels>::type rowdata_t; // a canvas row
+    typedef typename UintFor<Cols>::type paneldata_t;        // one panel's part of it
+    typedef typename UintFor<Rows>::type rowselect_t;
+
+    static constexpr uint8_t rows = Rows;
+    static constexpr uint8_t cols = Cols * Panels;
+    static constexpr uint8_t panelCols = Cols;
+    static constexpr uint8_t panels = Panels;
+    static constexpr uint8_t blankCycles = BlankCycles;
+    static constexpr rowdata_t blankData = (rowdata_t)~0;
+    static constexpr rowselect_t blankSelect = (rowselect_t)~0;
+
+    // SPI bytes per scan line, data then select for each panel, and the shortest bit plane that still outlasts
+    // shifting them out
+    static constexpr uint8_t spiBytes = (sizeof(paneldata_t) + sizeof(rowselect_t)) * Panels;
+    static constexpr uint16_t minPlanePeriod = spiBytes * 32 + 50;
+    static constexpr uint16_t maxPlanePeriod = 0xFFFF / SCAN_MAX_LEVEL; // a whole row still fits CCMP
+
+    // scan timing in TCB0 ticks, a line is lit for rowPeriod split over its bit planes, plane n for planePeriod << n
+    // so the planes add up to the row period, blank cycles and off lines last a full row period
+    static inline uint16_t planePeriod;
+    static inline uint16_t rowPeriod;
+    static inline uint16_t refreshRate; // frames per second the periods actually give
+
+    // draw variables, frames are indexed [plane][row], plane 0 is the least significant bit of the pixel level
+    // triple buffered: show() swaps the draw frame with the ready frame and the ISR swaps the ready frame
+    // with the display frame at a frame boundary, so neither side copies or waits on the other
+    static inline rowdata_t frames[3][SCAN_BIT_DEPTH][Rows];
+    static inline rowdata_t (*drawBuffer)[Rows] = frames[0];              // draw updates go here
+    static inline const rowdata_t (*volatile displayBuffer)[Rows] = frames[2]; // ISR shifts out data from this
+    static inline uint8_t drawIndex = 0;
+    static inline volatile uint8_t readyIndex = 1; // last frame passed to show(), shown at the next frame boundary if frameReady
+    static inline volatile uint8_t displayIndex = 2;
+
+    // SPI scan-out queue, filled by the TCB0 ISR and fed into the buffered SPI0 by its own interrupt
+    static inline volatile uint8_t spiQueue[spiBytes];
+    static inline volatile uint8_t spiQueueIndex = spiBytes;
+
+    // ISR state variables
+    static inline volatile bool frameReady = false; // flag to signal ISR that a new frame is ready to be shown
+    static inline volatile uint8_t curLine = 0;
+    static inline volatile uint8_t curPlane = 0;
+    static inline volatile uint8_t blankCount = 0;      // off cycles left before the next line write
+    static inline volatile uint8_t brightnessLevel = 0; // current !OE duty, ISR steps it towards brightnessTarget
+    static inline volatile uint8_t brightnessTarget = 0;
+    static inline uint8_t brightness = DEFAULT_BRIGHTNESS;
+    static inline bool displayEnabled;
+
+    // scan frames completed, counted at the frame boundary where a ready frame is swapped in, the main loop paces
+    // its rendering to it
+    static inline volatile uint16_t vsyncCount;
+
+    // frames the ISR put on display, and frames show() replaced before the ISR got to them
+    static inline uint32_t framesShown;
+    static inline uint32_t framesDropped;
+
+#if SCAN_STATS
+    // stats window, the ISRs add to it and readStats() empties it. Only the time sums are 32-bit, a second of ticks
+    // does not fit 16 bits. Scan ISRs are counted in whole frames from vsyncCount, so a window longer than 65536
+    // frames (over four minutes at 250 Hz) or with more than 65535 render passes reads wrong averages
+    static inline uint32_t statsStart; // millis()
+    static inline uint16_t statsVsync;
+    static inline uint32_t scanTicks;
+    static inline uint32_t spiTicks;
+    static inline uint16_t scanMin = 0xFFFF;
+    static inline uint16_t scanMax;
+    static inline uint16_t latencyMax;
+    static inline uint16_t renderStart; // micros(), a pass longer than 65 ms wraps
+    static inline uint32_t renderTime;  // us
+    static inline uint16_t renderCount;
+    static inline uint16_t renderMin = 0xFFFF; // us
+    static inline uint16_t renderMax;
+#endif
+
+    static void clear()
+    {
+        for (uint8_t p = 0; p < SCAN_BIT_DEPTH; p++)
+        {
+            for (uint8_t i = 0; i < Rows; i++)
+            {
+                drawBuffer[p][i] = 0;
+            }
+        }
+    }
+
+    // fades to the new state over a few frames
+    static void display(bool enabled)
+    {
+        displayEnabled = enabled;
+        brightnessTarget = displayEnabled ? brightness : 0;
+    }
+
+    static void setBrightness(uint8_t level)
+    {
+        brightness = level;
+        if (displayEnabled)
+        {
+            brightnessTarget = brightness;
+        }
+    }
+
+    static void init()
+    {
+        pinMode(OE_PIN, OUTPUT);
+        pinMode(LATCH_PIN, OUTPUT);
+        digitalWrite(OE_PIN, HIGH);
+        digitalWrite(LATCH_PIN, LOW);
+
+        SPI.begin();
+        SPI0.CTRLB |= SPI_BUFEN_bm; // buffered mode for the ISR scan-out, SPI.transfer() is not used after this
+
+        // Configure Timer A (TCA0) in split mode with WO5 on the alternate pin PC5 (OE_PIN), output is high
+        // (display off) for HCMP2 of every HPER + 1 counts, so the compare value is the inverse of the brightness
+        takeOverTCA0();
+        PORTMUX.CTRLC |= PORTMUX_TCA05_bm;
+        TCA0.SPLIT.CTRLD = TCA_SPLIT_SPLITM_bm;
+        TCA0.SPLIT.HPER = BRIGHTNESS_PWM_PERIOD;
+        TCA0.SPLIT.HCMP2 = 255 - brightnessLevel;
+        TCA0.SPLIT.CTRLB = TCA_SPLIT_HCMP2EN_bm;
+        TCA0.SPLIT.CTRLA = TCA_SPLIT_CLKSEL_DIV1_gc | TCA_SPLIT_ENABLE_bm;
+
+        // Configure Timer B (TCB0) for periodic interrupts from 10MHz, the ISR reloads CCMP for each bit plane
+        TCB0.CTRLA = TCB_ENABLE_bm | TCB_CLKSEL_CLKDIV2_gc;
+        TCB0.CTRLB = TCB_CNTMODE_INT_gc; // CTC mode
+        setRefreshRate(SCAN_REFRESH_RATE);
+        TCB0.CCMP = rowPeriod - 1;
+        TCB0.INTCTRL = TCB_CAPT_bm;      // Enable interrupt on capture
+    }
+
+    // sets the periods for hz frames per second, as close as the SPI transfer time and the 16 bit timer allow,
+    // returns the refresh rate achieved
+    static uint16_t setRefreshRate(uint16_t hz)
+    {
+        uint32_t lineTicks = SCAN_TICK_HZ / ((uint32_t)(hz ? hz : 1) * Rows * (1 + BlankCycles));
+        uint32_t plane = lineTicks / SCAN_MAX_LEVEL;
+        if (plane < minPlanePeriod)
+            plane = minPlanePeriod;
+        if (plane > maxPlanePeriod)
+            plane = maxPlanePeriod;
+
+        uint16_t row = plane * SCAN_MAX_LEVEL;
+        uint32_t frameTicks = (uint32_t)row * Rows * (1 + BlankCycles);
+        uint16_t rate = (SCAN_TICK_HZ + frameTicks / 2) / frameTicks;
+
+        // the I2C telemetry reads the rate from the TWI interrupt
+        uint8_t oldSREG = SREG;
+        cli();
+        planePeriod = plane;
+        rowPeriod = row;
+        refreshRate = rate;
+        SREG = oldSREG;
+        return rate;
+    }
+
+#if SCAN_STATS
+    // brackets a render pass in the main loop
+    static void renderBegin()
+    {
+        renderStart = micros();
+    }
+
+    static void renderEnd()
+    {
+        uint16_t duration = (uint16_t)micros() - renderStart;
+
+        uint8_t oldSREG = SREG;
+        cli();
+        renderTime += duration;
+        renderCount++;
+        if (duration < renderMin)
+            renderMin = duration;
+        if (duration > renderMax)
+            renderMax = duration;
+        SREG = oldSREG;
+    }
+
+    // fills stats for the time since the last call and starts a new window
+    static void readStats(ScanStats &stats)
+    {
+        uint8_t oldSREG = SREG;
+        cli();
+        uint32_t now = millis();
+        uint32_t elapsed = now - statsStart; // ms
+        uint32_t isrs = (uint32_t)(uint16_t)(vsyncCount - statsVsync) * Rows * (SCAN_BIT_DEPTH + BlankCycles);
+        uint32_t isrTotal = scanTicks + spiTicks;
+        uint32_t renderTotal = renderTime;
+        uint16_t renders = renderCount;
+        stats.isrMin = isrs ? scanMin : 0;
+        stats.isrMax = scanMax;
+        stats.isrAvg = isrs ? scanTicks / isrs : 0;
+        stats.latencyMax = latencyMax;
+        stats.renderMin = renders ? renderMin : 0;
+        stats.renderMax = renderMax;
+
+        statsStart = now;
+        statsVsync = vsyncCount;
+        scanTicks = spiTicks = 0;
+        scanMin = 0xFFFF;
+        scanMax = latencyMax = 0;
+        renderTime = renderCount = 0;
+        renderMin = 0xFFFF;
+        renderMax = 0;
+        SREG = oldSREG;
+
+        stats.renderAvg = renders ? renderTotal / renders : 0;
+        stats.isrLoad = permille(isrTotal, elapsed * SCAN_TICKS_PER_US);
+        stats.renderLoad = permille(renderTotal, elapsed);
+    }
+
+    // part per mille of a whole given in thousandths, capped at all of it
+    static uint16_t permille(uint32_t part, uint32_t wholePerMille)
+    {
+        if (wholePerMille == 0)
+            return 0;
+        part /= wholePerMille;
+        return part < 1000 ? part : 1000;
+    }
+#endif
+
+    static void setPixelLevel(int x, int y, uint8_t level)
+    {
+        if (x < 0 || x >= cols || y < 0 || y >= Rows)
+            return;
+
+        if (level > SCAN_MAX_LEVEL)
+            level = SCAN_MAX_LEVEL;
+
+        rowdata_t mask = (rowdata_t)1 << x;
+        for (uint8_t p = 0; p < SCAN_BIT_DEPTH; p++)
+        {
+            if (level & (1 << p))
+                drawBuffer[p][y] |= mask;
+            else
+                drawBuffer[p][y] &= ~mask;
+        }
+    }
+
+    // sets (or clears) the pixels in mask at full level
+    static void blitRow(uint8_t row, rowdata_t mask, bool on)
+    {
+        for (uint8_t p = 0; p < SCAN_BIT_DEPTH; p++)
+        {
+            if (on)
+                drawBuffer[p][row] |= mask;
+            else
+                drawBuffer[p][row] &= ~mask;
+        }
+    }
+
+    static void setRow(uint8_t row, rowdata_t rowData)
+    {
+        for (uint8_t p = 0; p < SCAN_BIT_DEPTH; p++)
+        {
+            drawBuffer[p][row] = rowData;
+        }
+    }
 
-    // calculate row data and select
-    rowdata_t rowData = BLANK_DATA;
-    rowdata_t rowSelect = BLANK_DATA;
-    if (displayEnabled && blankCycles == 0)
+    static void show()
     {
-        rowData = ~displayBuffer[curLine];
-        rowSelect = ~(0x01 << curLine);
+        uint8_t oldSREG = SREG;
+        cli();
+        if (frameReady)
+            framesDropped++;
+        uint8_t ready = readyIndex;
+        readyIndex = drawIndex;
+        drawIndex = ready;
+        frameReady = true;
+        SREG = oldSREG;
+
+        drawBuffer = frames[drawIndex];
+    }
+
+    // index of the last frame passed to show(), the ISR moves it from ready to display but never writes it
+    static uint8_t lastIndex()
+    {
+        uint8_t oldSREG = SREG;
+        cli();
+        uint8_t last = frameReady ? readyIndex : displayIndex;
+        SREG = oldSREG;
+
+        return last;
     }
 
-    // shift out row data
-    #if defined(MATRIX_16X16)
-    SPI.transfer16(rowData);
-    SPI.transfer16(rowSelect);
-    #elif defined(MATRIX_8X8)
-    SPI.transfer(rowData);
-    SPI.transfer(rowSelect);
-    #endif
-    digitalWrite(LATCH_PIN, LOW);
-    digitalWrite(LATCH_PIN, HIGH);
+    static uint16_t vsync()
+    {
+        uint8_t oldSREG = SREG;
+        cli();
+        uint16_t count = vsyncCount;
+        SREG = oldSREG;
+
+        return count;
+    }
 
-    // update the current line and blank cycles
-    if (blankCycles == 0)
+    static void readFrameCounts(uint32_t &shown, uint32_t &dropped)
     {
-        curLine = (curLine + 1) % NUM_ROWS;
-        blankCycles = NUM_BLANK_CYCLES;
+        uint8_t oldSREG = SREG;
+        cli();
+        shown = framesShown;
+        dropped = framesDropped;
+        SREG = oldSREG;
     }
-    else {
-        blankCycles--;
+
+    // copies the last frame passed to show() into the draw buffer, for drawing over it instead of a new frame
+    static void retain()
+    {
+        memcpy(drawBuffer, frames[lastIndex()], sizeof(frames[0]));
     }
 
-    // swap in new frame if available after finishing last frame
-    if (bufferUpdate && curLine == 0 && blankCycles == NUM_BLANK_CYCLES)
+    // same as retain() for a single row
+    static void retainRow(uint8_t row)
     {
-        for (int i = 0; i < NUM_ROWS; i++)
+        uint8_t last = lastIndex();
+        for (uint8_t p = 0; p < SCAN_BIT_DEPTH; p++)
         {
-            displayBuffer[i] = drawBuffer[i];
+            drawBuffer[p][row] = frames[last][p][row];
         }
+    }
 
-        bufferUpdate = false;
+    // shifts the last frame one column left into the draw buffer, bit n of column lights row n of the rightmost column
+    static void shiftLeft(uint32_t column)
+    {
+        uint8_t last = lastIndex();
+        for (uint8_t row = 0; row < Rows; row++)
+        {
+            rowdata_t in = (column >> row) & 1 ? (rowdata_t)1 << (cols - 1) : 0;
+            for (uint8_t p = 0; p < SCAN_BIT_DEPTH; p++)
+            {
+                drawBuffer[p][row] = (rowdata_t)(frames[last][p][row] >> 1) | in;
+            }
+        }
     }
-}
\ No newline at end of file
+
+    // moves the last frame count rows up into the draw buffer, the rows are whole so this is only an index offset, the
+    // bottom count rows are left for the caller to set
+    static void shiftUp(uint8_t count)
+    {
+        uint8_t last = lastIndex();
+        for (uint8_t row = 0; row + count < Rows; row++)
+        {
+            for (uint8_t p = 0; p < SCAN_BIT_DEPTH; p++)
+            {
+                drawBuffer[p][row] = frames[last][p][row + count];
+            }
+        }
+    }
+
+    // writes queued bytes while the SPI0 buffer has room, then waits on the data register empty interrupt
+    // for more room or on transmit complete once everything is queued
+    static inline void feedSpi()
+    {
+        uint8_t i = spiQueueIndex;
+        while (i < spiBytes && (SPI0.INTFLAGS & SPI_DREIF_bm))
+        {
+            SPI0.DATA = spiQueue[i++];
+        }
+        spiQueueIndex = i;
+        SPI0.INTCTRL = i < spiBytes ? SPI_DREIE_bm : SPI_TXCIE_bm;
+    }
+
+    // queues row data then select MSB first for each panel, farthest panel first so each ends up in its own shift
+    // registers, and starts shifting them out, latched by the SPI interrupt when done
+    static inline void queueRow(rowdata_t rowData, rowselect_t rowSelect)
+    {
+        uint8_t i = 0;
+        for (int8_t panel = Panels - 1; panel >= 0; panel--)
+        {
+            paneldata_t panelData = (paneldata_t)(rowData >> (panel * Cols));
+            for (int8_t shift = (sizeof(paneldata_t) - 1) * 8; shift >= 0; shift -= 8)
+            {
+                spiQueue[i++] = (uint8_t)(panelData >> shift);
+            }
+            for (int8_t shift = (sizeof(rowselect_t) - 1) * 8; shift >= 0; shift -= 8)
+            {
+                spiQueue[i++] = (uint8_t)(rowSelect >> shift);
+            }
+        }
+
+        SPI0.INTFLAGS = SPI_TXCIF_bm; // clear stale transmit complete from the last row
+        spiQueueIndex = 0;
+        feedSpi();
+    }
+
+    // SPI0_INT_vect
+    static inline void spiInterrupt()
+    {
+#if SCAN_STATS
+        uint16_t start = TCB0.CNT;
+#endif
+
+        if (spiQueueIndex < spiBytes)
+        {
+            feedSpi();
+        }
+        else if (SPI0.INTFLAGS & SPI_TXCIF_bm)
+        {
+            SPI0.INTFLAGS = SPI_TXCIF_bm;
+            SPI0.INTCTRL = 0;
+
+            LATCH_VPORT.OUT &= ~LATCH_PIN_bm;
+            LATCH_VPORT.OUT |= LATCH_PIN_bm;
+        }
+
+#if SCAN_STATS
+        uint16_t end = TCB0.CNT;
+        if (end > start) // skip the rare call that spans a TCB0 period
+            spiTicks += end - start;
+#endif
+    }
+
+    // TCB0_INT_vect
+    static inline void scanInterrupt()
+    {
+#if SCAN_STATS
+        // the counter restarted at the compare match, so it holds the entry latency
+        uint16_t latency = TCB0.CNT;
+#endif
+
+        // clear interrupt flag
+        TCB0.INTFLAGS = TCB_CAPT_bm;
+
+        // calculate row data and select, lit planes last a power of two slices, blank cycles a full row
+        rowdata_t rowData = blankData;
+        rowselect_t rowSelect = blankSelect;
+        if (brightnessLevel != 0 && blankCount == 0)
+        {
+            TCB0.CCMP = (planePeriod << curPlane) - 1;
+            rowData = ~displayBuffer[curPlane][curLine];
+            rowSelect = ~((rowselect_t)1 << curLine);
+        }
+        else
+        {
+            TCB0.CCMP = rowPeriod - 1;
+        }
+
+        // start shifting out row data, latched when the transfer completes
+        queueRow(rowData, rowSelect);
+
+        // update the current plane, line and blank cycles
+        if (blankCount == 0)
+        {
+            if (++curPlane == SCAN_BIT_DEPTH)
+            {
+                curPlane = 0;
+                curLine = (curLine + 1) % Rows;
+                blankCount = BlankCycles;
+            }
+        }
+        else
+        {
+            blankCount--;
+        }
+
+        // frame boundary, swap in new frame if available and step any brightness fade
+        if (curLine == 0 && curPlane == 0 && blankCount == BlankCycles)
+        {
+            vsyncCount++;
+            if (frameReady)
+            {
+                uint8_t shown = displayIndex;
+                displayIndex = readyIndex;
+                readyIndex = shown;
+                displayBuffer = frames[displayIndex];
+                frameReady = false;
+                framesShown++;
+            }
+
+            if (brightnessLevel != brightnessTarget)
+            {
+                uint8_t level = brightnessLevel;
+                if (level < brightnessTarget)
+                    level = (brightnessTarget - level > BRIGHTNESS_FADE_STEP) ? level + BRIGHTNESS_FADE_STEP : brightnessTarget;
+                else
+                    level = (level - brightnessTarget > BRIGHTNESS_FADE_STEP) ? level - BRIGHTNESS_FADE_STEP : brightnessTarget;
+
+                brightnessLevel = level;
+                TCA0.SPLIT.HCMP2 = 255 - level;
+            }
+        }
+
+#if SCAN_STATS
+        uint16_t duration = TCB0.CNT;
+        scanTicks += duration;
+        if (duration < scanMin)
+            scanMin = duration;
+        if (duration > scanMax)
+            scanMax = duration;
+        if (latency > latencyMax)
+            latencyMax = latency;
+#endif
+    }
+};
+
+// the matrix this build drives, the rest of the firmware uses it through the scan*() functions below
+typedef ScanMatrix<MATRIX_ROWS, MATRIX_COLS, MATRIX_BLANK_CYCLES, MATRIX_PANELS> Matrix;
+typedef Matrix::rowdata_t rowdata_t;
+static_assert(sizeof(Matrix::frames) + sizeof(Matrix::spiQueue) <= SCAN_FRAME_BUDGET,
+              "frame buffers too big for SRAM, use fewer panels or a lower SCAN_BIT_DEPTH, 16-row panels do not chain");
+
+#define NUM_ROWS MATRIX_ROWS
+#define NUM_COLS (MATRIX_COLS * MATRIX_PANELS)
+#define NUM_LEDS (NUM_ROWS * NUM_COLS)
+#define NUM_BLANK_CYCLES MATRIX_BLANK_CYCLES
+#define MATRIX_HEIGHT NUM_ROWS
+#define MATRIX_WIDTH NUM_COLS
+
+inline void scanClear() { Matrix::clear(); }
+inline void scanDisplay(bool enabled) { Matrix::display(enabled); }
+inline void scanSetBrightness(uint8_t level) { Matrix::setBrightness(level); }
+inline void scanInit() { Matrix::init(); }
+inline uint16_t scanSetRefreshRate(uint16_t hz) { return Matrix::setRefreshRate(hz); }
+inline uint16_t scanRefreshRate() { return Matrix::refreshRate; }
+inline void scanSetPixelLevel(int x, int y, uint8_t level) { Matrix::setPixelLevel(x, y, level); }
+inline void scanSetPixel(int x, int y, bool on) { Matrix::setPixelLevel(x, y, on ? SCAN_MAX_LEVEL : 0); }
+inline void scanBlitRow(uint8_t row, rowdata_t mask, bool on) { Matrix::blitRow(row, mask, on); }
+inline void scanSetRow(uint8_t row, rowdata_t rowData) { Matrix::setRow(row, rowData); }
+inline void scanShow() { Matrix::show(); }
+inline uint8_t scanLastIndex() { return Matrix::lastIndex(); }
+inline void scanRetain() { Matrix::retain(); }
+inline void scanRetainRow(uint8_t row) { Matrix::retainRow(row); }
+inline void scanShiftLeft(uint32_t column) { Matrix::shiftLeft(column); }
+inline void scanShiftUp(uint8_t count) { Matrix::shiftUp(count); }
+inline uint16_t scanVsyncCount() { return Matrix::vsync(); }
+inline void scanReadFrameCounts(uint32_t &shown, uint32_t &dropped) { Matrix::readFrameCounts(shown, dropped); }
+#if SCAN_STATS
+inline void scanRenderBegin() { Matrix::renderBegin(); }
+inline void scanRenderEnd() { Matrix::renderEnd(); }
+inline void scanReadStats(ScanStats &stats) { Matrix::readStats(stats); }
+#else
+inline void scanRenderBegin() {}
+inline void scanRenderEnd() {}
+#endif
+
+ISR(SPI0_INT_vect)
+{
+    Matrix::spiInterrupt();
+}
+
+ISR(TCB0_INT_vect)
+{
+    Matrix::scanInterrupt();
+}
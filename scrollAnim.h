@@ -1,55 +1,70 @@
 #include "scanMatrix.h"
 
-#if defined(MATRIX_16X16)
-#define SCROLL_WIDTH 64
-#define SCROLL_INDEX_INITIAL 0
-typedef uint64_t scrolldata_t;
-const scrolldata_t ScrollData[NUM_ROWS] = {
-    0b0000000110000000000000000011111100000000000000111111110000000000,
-    0b0000001111000000000000001111110011000000000011111111111100000000,
-    0b0000001111000000000000010011110000100000000111100000011110000000,
-    0b0000011111100000000000100111111100010000001110001001000111000000,
-    0b1111111111111111000000101100001110010000001110001001000111000000,
-    0b0111110110111110000001111000000111111000001111000000001111000000,
-    0b0011110110111100000001111000000110011000000111111111111110000000,
-    0b0001110110111000000001011000000100001000000011111111111100000000,
-    0b0001111111111000000001001100001100001000000000111111110000000000,
-    0b0001111111111000000001001111111110011000000110001001000110000000,
-    0b0011111111111100000001011111111111111000001001101001011001000000,
-    0b0011111111111100000000111001001001110000001000111001100001000000,
-    0b0111111111111110000000010001001000100000001000001001000001000000,
-    0b0111111001111110000000010000000000100000000100000000000010000000,
-    0b1111100000011111000000001000000001000000000011000000001100000000,
-    0b1110000000000111000000000111111110000000000000111111110000000000,
+// scrolling art for 8 and 16 row panels, taller panels repeat it
+template <uint8_t Rows>
+struct ScrollArt;
+
+template <>
+struct ScrollArt<16>
+{
+    typedef uint64_t scrolldata_t;
+    static constexpr uint8_t rows = 16;
+    static constexpr uint8_t width = 64;
+    static constexpr uint8_t initialIndex = 0;
+    static constexpr scrolldata_t data[16] = {
+        0b0000000110000000000000000011111100000000000000111111110000000000,
+        0b0000001111000000000000001111110011000000000011111111111100000000,
+        0b0000001111000000000000010011110000100000000111100000011110000000,
+        0b0000011111100000000000100111111100010000001110001001000111000000,
+        0b1111111111111111000000101100001110010000001110001001000111000000,
+        0b0111110110111110000001111000000111111000001111000000001111000000,
+        0b0011110110111100000001111000000110011000000111111111111110000000,
+        0b0001110110111000000001011000000100001000000011111111111100000000,
+        0b0001111111111000000001001100001100001000000000111111110000000000,
+        0b0001111111111000000001001111111110011000000110001001000110000000,
+        0b0011111111111100000001011111111111111000001001101001011001000000,
+        0b0011111111111100000000111001001001110000001000111001100001000000,
+        0b0111111111111110000000010001001000100000001000001001000001000000,
+        0b0111111001111110000000010000000000100000000100000000000010000000,
+        0b1111100000011111000000001000000001000000000011000000001100000000,
+        0b1110000000000111000000000111111110000000000000111111110000000000,
+    };
 };
 
-#elif defined(MATRIX_8X8)
-#define SCROLL_WIDTH 32
-#define SCROLL_INDEX_INITIAL 29
-typedef uint32_t scrolldata_t;
-const scrolldata_t ScrollData[NUM_ROWS] = {
-    0b00011000000011110000001111110000,
-    0b00011000000111111000011000011000,
-    0b11111111001111111100011000011000,
-    0b01111110001111111100001111110000,
-    0b00111100001111111100000011000000,
-    0b01111110000100001000011011011000,
-    0b01100110000100001000011111111000,
-    0b11000011000011110000000111100000,
+template <>
+struct ScrollArt<8>
+{
+    typedef uint32_t scrolldata_t;
+    static constexpr uint8_t rows = 8;
+    static constexpr uint8_t width = 32;
+    static constexpr uint8_t initialIndex = 29;
+    static constexpr scrolldata_t data[8] = {
+        0b00011000000011110000001111110000,
+        0b00011000000111111000011000011000,
+        0b11111111001111111100011000011000,
+        0b01111110001111111100001111110000,
+        0b00111100001111111100000011000000,
+        0b01111110000100001000011011011000,
+        0b01100110000100001000011111111000,
+        0b11000011000011110000000111100000,
+    };
 };
-#endif
 
-int scrollIndex = SCROLL_INDEX_INITIAL;
+typedef ScrollArt<(NUM_ROWS >= 16 ? 16 : 8)> scrollArt_t;
+
+int scrollIndex = scrollArt_t::initialIndex;
 
-void scrollAnim()
+// draws the next frame, steps columns on from the last one
+void scrollAnim(uint8_t steps = 1)
 {
     scanClear();
     for (uint8_t i = 0; i < NUM_ROWS; i++)
     {
-        rowdata_t rowData = (ScrollData[i] << scrollIndex) | (ScrollData[i] >> (SCROLL_WIDTH - scrollIndex));
+        scrollArt_t::scrolldata_t art = scrollArt_t::data[i % scrollArt_t::rows];
+        rowdata_t rowData = scrollIndex ? (art << scrollIndex) | (art >> (scrollArt_t::width - scrollIndex)) : art;
         scanSetRow(i, rowData);
     }
     scanShow();
 
-    scrollIndex = (scrollIndex + 1) % SCROLL_WIDTH;
+    scrollIndex = (scrollIndex + steps) % scrollArt_t::width;
 }
@@ -3,35 +3,248 @@
 #include "drawText.h"
 #include "scanMatrix.h"
 
-#define MAX_MESSAGE_SIZE 140
 #define MESSAGE_X_OFFSET 3
-#if defined(MATRIX_16X16)
-#define MESSAGE_Y_OFFSET 5
-#elif defined(MATRIX_8X8)
-#define MESSAGE_Y_OFFSET 2
-#endif
+#define MESSAGE_Y_OFFSET (NUM_ROWS >= 16 ? NUM_ROWS / 2 - 3 : 2) // text baseline up from the bottom row
 
+// vertical scrolling, the message word wrapped into centered lines SCROLL_LINE_PITCH rows apart, SCROLL_LINES of them
+// to a screen, '|' starts a new line. Paged scrolling holds each line for SCROLL_PAGE_HOLD steps once it is all in.
+constexpr uint8_t SCROLL_LINES = NUM_ROWS > font_t::height ? NUM_ROWS / (font_t::height + 1) : 1;
+constexpr uint8_t SCROLL_LINE_PITCH = NUM_ROWS / SCROLL_LINES;
+constexpr uint8_t SCROLL_LINE_TOP = SCROLL_LINE_PITCH > font_t::height ? (SCROLL_LINE_PITCH - font_t::height) / 2 : 0;
+#define SCROLL_PAGE_HOLD 20 // scroll steps
+
+// the I2C message register writes straight into scrollMessage, scrollTextEditing is set from the first byte until
+// scrollTextUpdate() indexes the new text, and the text modes hold their last frame meanwhile
 char scrollMessage[MAX_MESSAGE_SIZE];
+bool scrollTextEditing = false;
+TextIndex scrollMessageIndex;
 int16_t scrollMessageWidth;
 int16_t scrollMessageX = NUM_COLS;
-int16_t scrollMessageY = NUM_ROWS;
 unsigned long lastTempMessage = 0; // time left for temporary message display
 
-void scrollTextSetMessage(const char *newMessage)
+// column feeder, position in the message of the next column to enter at the right edge
+uint8_t scrollCharIndex = 0;
+uint8_t scrollCharColumn = 0;
+bool scrollFrameStale = true; // last frame shown does not hold the message at scrollMessageX
+
+// row feeder for vertical scrolling, the line entering at the bottom edge and its next row
+uint8_t scrollLineStart = 0;  // message index of the line
+uint8_t scrollLineLength = 0;
+int16_t scrollLineX = 0;
+uint8_t scrollLineRow = 0;
+uint8_t scrollBlankLines = 0; // lines fed past the end of the message
+uint8_t scrollHold = 0;       // steps a paged line stays still
+
+// call when something else was drawn, the next scroll step redraws the message instead of shifting
+void scrollTextInvalidate()
+{
+  scrollFrameStale = true;
+}
+
+// sets character index of the message, which stops showing until scrollTextUpdate()
+void scrollTextWrite(uint8_t index, char c)
+{
+  scrollMessage[index] = c;
+  scrollTextEditing = true;
+}
+
+// starts scrolling the message as written, from the right edge
+void scrollTextUpdate()
 {
-  strncpy(scrollMessage, newMessage, MAX_MESSAGE_SIZE - 1);
   scrollMessage[MAX_MESSAGE_SIZE - 1] = '\0';
-  scrollMessageWidth = getTextWidth(scrollMessage);
+  scrollMessageWidth = buildTextIndex(scrollMessage, scrollMessageIndex);
   scrollMessageX = MATRIX_WIDTH;
+  scrollTextEditing = false;
+  scrollTextInvalidate();
 }
 
-void scrollText() {
-  scanClear();
-  drawString(scrollMessageX, MATRIX_HEIGHT - MESSAGE_Y_OFFSET, MATRIX_WIDTH, MATRIX_HEIGHT, scrollMessage, true);
-  scanShow();
+void scrollTextSetMessage(const char *newMessage)
+{
+  strncpy(scrollMessage, newMessage, MAX_MESSAGE_SIZE - 1);
+  scrollTextUpdate();
+}
 
+// points the feeder at message column col
+void scrollTextSeek(int16_t col)
+{
+  scrollCharIndex = 0;
+  scrollCharColumn = 0;
+  if (col > 0 && scrollMessageIndex.count > 0)
+  {
+    uint8_t sample = findTextIndex(scrollMessageIndex, col);
+    scrollCharIndex = sample * TEXT_INDEX_STRIDE;
+    col -= scrollMessageIndex.widths[sample];
+  }
+
+  while (col > 0 && scrollMessage[scrollCharIndex])
+  {
+    uint8_t charWidth = getCharWidth(scrollMessage[scrollCharIndex]);
+    if (col < charWidth)
+    {
+      scrollCharColumn = col;
+      break;
+    }
+    col -= charWidth;
+    scrollCharIndex++;
+  }
+}
+
+// next message column from the feeder, blank past the end of the message
+uint32_t scrollTextNextColumn()
+{
+  char c;
+  while ((c = scrollMessage[scrollCharIndex]))
+  {
+    uint8_t charWidth = getCharWidth(c);
+    if (scrollCharColumn < charWidth)
+    {
+      uint32_t column = getCharColumn(c, scrollCharColumn, MATRIX_HEIGHT - MESSAGE_Y_OFFSET);
+      if (++scrollCharColumn == charWidth)
+      {
+        scrollCharColumn = 0;
+        scrollCharIndex++;
+      }
+      return column;
+    }
+
+    // not in font
+    scrollCharColumn = 0;
+    scrollCharIndex++;
+  }
+
+  return 0;
+}
+
+// moves the message one column left, back to the right edge once it has scrolled off
+void scrollTextAdvance()
+{
   if (--scrollMessageX < -scrollMessageWidth)
   {
     scrollMessageX = MATRIX_WIDTH;
+    scrollTextSeek(0);
+  }
+}
+
+// each step shifts the last frame left and renders only the column entering at the right edge, skipping columns
+// redraws the message where it lands instead
+void scrollText(uint8_t steps = 1)
+{
+  while (steps-- > 1)
+  {
+    scrollTextAdvance();
+    scrollTextInvalidate();
   }
-}
\ No newline at end of file
+
+  if (scrollFrameStale)
+  {
+    scanClear();
+    drawString(scrollMessageX, MATRIX_HEIGHT - MESSAGE_Y_OFFSET, MATRIX_WIDTH, MATRIX_HEIGHT, scrollMessage, true,
+               scrollMessageIndex);
+    scrollTextSeek(MATRIX_WIDTH - scrollMessageX);
+    scrollFrameStale = false;
+  }
+  else
+  {
+    scanShiftLeft(scrollMessageX < MATRIX_WIDTH ? scrollTextNextColumn() : 0);
+  }
+  scanShow();
+
+  scrollTextAdvance();
+}
+
+// wraps the line starting at message index start, past the break that ended the line before
+void scrollTextStartLine(uint8_t start)
+{
+  if (start > 0)
+  {
+    while (scrollMessage[start] == ' ')
+      start++;
+    if (scrollMessage[start] == '|')
+      start++;
+    while (scrollMessage[start] == ' ')
+      start++;
+  }
+
+  uint16_t width;
+  scrollLineStart = start;
+  scrollLineLength = wrapTextLine(scrollMessage + start, MATRIX_WIDTH, width);
+  scrollLineX = (MATRIX_WIDTH - (int16_t)width) / 2;
+  scrollLineRow = 0;
+}
+
+// next row from the feeder, a screen of blank lines after the message, then the message again
+rowdata_t scrollTextNextRow()
+{
+  rowdata_t row = 0;
+  uint8_t glyphRow = scrollLineRow - SCROLL_LINE_TOP;
+  if (scrollBlankLines == 0 && glyphRow < font_t::height)
+  {
+    row = getTextRow(scrollMessage + scrollLineStart, scrollLineLength, scrollLineX, glyphRow);
+  }
+
+  if (++scrollLineRow == SCROLL_LINE_PITCH)
+  {
+    uint8_t next = scrollLineStart + scrollLineLength;
+    if (scrollBlankLines > 0 || scrollMessage[next] == '\0' ||
+        scrollMessage[next + strspn(scrollMessage + next, " ")] == '\0')
+    {
+      scrollBlankLines = (scrollBlankLines + 1) % (SCROLL_LINES + 1);
+      next = 0;
+    }
+    scrollTextStartLine(scrollBlankLines == 0 ? next : scrollLineStart);
+  }
+  return row;
+}
+
+// each step moves the last frame up a row by row index and renders only the row entering at the bottom edge, a paged
+// scroll stops with each line all in
+void scrollTextVertical(uint8_t steps, bool paged)
+{
+  if (scrollFrameStale)
+  {
+    // starts over from a blank screen
+    scrollBlankLines = 0;
+    scrollHold = 0;
+    scrollTextStartLine(0);
+    scanClear();
+    scanShow();
+    scrollFrameStale = false;
+    return;
+  }
+
+  // rows entering this pass, at most a screen of them is kept
+  rowdata_t rows[NUM_ROWS];
+  uint8_t count = 0;
+  while (steps-- > 0)
+  {
+    if (scrollHold > 0)
+    {
+      scrollHold--;
+      continue;
+    }
+
+    bool text = scrollBlankLines == 0;
+    rowdata_t row = scrollTextNextRow();
+    if (count == NUM_ROWS)
+    {
+      memmove(rows, rows + 1, sizeof(rows) - sizeof(rows[0]));
+      count--;
+    }
+    rows[count++] = row;
+    if (paged && text && scrollLineRow == 0)
+    {
+      scrollHold = SCROLL_PAGE_HOLD;
+    }
+  }
+  if (count == 0)
+  {
+    return;
+  }
+
+  scanShiftUp(count);
+  for (uint8_t i = 0; i < count; i++)
+  {
+    scanSetRow(NUM_ROWS - count + i, rows[i]);
+  }
+  scanShow();
+}
@@ -0,0 +1,316 @@
+#pragma once
+
+#include <EEPROM.h>
+
+#include "packedSprite.h"
+#include "scanMatrix.h"
+
+// sprite animations, centered on the panel, picked by index with spriteAnimSelect() or uploaded over I2C
+
+constexpr SpriteFrame<8> heartFrames[] = {
+    {500, {".##..##.",
+           "########",
+           "########",
+           "########",
+           ".######.",
+           "..####..",
+           "...##...",
+           "........"}},
+    {250, {"........",
+           "..#..#..",
+           ".######.",
+           ".######.",
+           "..####..",
+           "...##...",
+           "........",
+           "........"}},
+};
+
+constexpr SpriteFrame<8> pacmanFrames[] = {
+    {200, {"..####..",
+           ".######.",
+           "#####...",
+           "####....",
+           "####....",
+           "#####...",
+           ".######.",
+           "..####.."}},
+    {200, {"..####..",
+           ".######.",
+           "########",
+           "########",
+           "########",
+           "########",
+           ".######.",
+           "..####.."}},
+};
+
+constexpr SpriteFrame<8> invaderFrames[] = {
+    {400, {"..#.....#..",
+           "...#...#...",
+           "..#######..",
+           ".##.###.##.",
+           "###########",
+           "#.#######.#",
+           "#.#.....#.#",
+           "...##.##..."}},
+    {400, {"..#.....#..",
+           "#..#...#..#",
+           "#.#######.#",
+           "###.###.###",
+           "###########",
+           ".#########.",
+           "..#.....#..",
+           ".#.......#."}},
+};
+
+typedef PACKED_SPRITE(heartFrames) heartSprite_t;
+typedef PACKED_SPRITE(pacmanFrames) pacmanSprite_t;
+typedef PACKED_SPRITE(invaderFrames) invaderSprite_t;
+constexpr heartSprite_t HEART_SPRITE PROGMEM = packSprite<heartSprite_t>(heartFrames);
+constexpr pacmanSprite_t PACMAN_SPRITE PROGMEM = packSprite<pacmanSprite_t>(pacmanFrames);
+constexpr invaderSprite_t INVADER_SPRITE PROGMEM = packSprite<invaderSprite_t>(invaderFrames);
+
+const SpriteAnimation SPRITE_ANIMATIONS[] PROGMEM = {
+    spriteAnimation(HEART_SPRITE),
+    spriteAnimation(PACMAN_SPRITE),
+    spriteAnimation(INVADER_SPRITE),
+};
+#define SPRITE_ANIMATION_COUNT (sizeof(SPRITE_ANIMATIONS) / sizeof(SPRITE_ANIMATIONS[0]))
+
+// an animation uploaded by the host, rows, width and frame count then packed frames in the same format as
+// packSprite(), kept in an EEPROM area lent by the caller (savedConfig.h) so it costs no SRAM, outlives any other
+// write and plays again after a power cycle. The area starts with the length of the checked upload, 0xFF while there
+// is none, so the player never reads past what was written and an upload cut short is never played. Bytes go
+// straight to EEPROM, a few ms each unless unchanged, which holds loop() up during an upload but never the bus.
+#define SPRITE_UPLOAD_HEADER 3
+#define SPRITE_UPLOAD_NONE 0xFF
+
+uint16_t spriteUploadAddress = 0; // length byte, the upload follows it
+uint8_t spriteUploadSize = 0;     // bytes after the length byte
+uint8_t spriteUploadLength = 0;
+bool spriteUploadValid = false;
+
+// player state, the frame on display is the only copy of the decoded sprite
+SpriteAnimation spriteAnimCurrent;
+uint8_t spriteAnimFrame = 0;          // next frame to decode
+uint16_t spriteAnimOffset = 0;        // its place in the packed data
+uint16_t spriteAnimDuration = 0;      // ms the frame on display lasts
+uint16_t spriteAnimFrameStart = 0;    // low bits of millis(), frames last at most 2.55 s
+bool spriteAnimStale = true;          // restart from the first frame, something else was drawn
+
+void spriteAnimInvalidate()
+{
+    spriteAnimStale = true;
+}
+
+void spriteAnimSelect(uint8_t index)
+{
+    memcpy_P(&spriteAnimCurrent, &SPRITE_ANIMATIONS[index % SPRITE_ANIMATION_COUNT], sizeof(SpriteAnimation));
+    spriteAnimInvalidate();
+}
+
+inline uint8_t spriteUploadByte(uint16_t offset)
+{
+    return EEPROM.read(spriteUploadAddress + 1 + offset);
+}
+
+// plays the upload, a blank frame until there is a valid one
+void spriteAnimSelectUploaded()
+{
+    if (spriteUploadValid)
+    {
+        spriteAnimCurrent = {nullptr, spriteUploadByte(0), spriteUploadByte(1), spriteUploadByte(2), true};
+    }
+    else
+    {
+        spriteAnimCurrent = {nullptr, 0, 0, 0, true};
+    }
+    spriteAnimInvalidate();
+}
+
+// true if the first length bytes of the area hold exactly the frames their header gives
+bool spriteUploadCheck(uint8_t length)
+{
+    if (length < SPRITE_UPLOAD_HEADER || length > spriteUploadSize)
+    {
+        return false;
+    }
+    const uint8_t rows = spriteUploadByte(0);
+    const uint8_t width = spriteUploadByte(1);
+    const uint8_t frames = spriteUploadByte(2);
+    if (rows < 1 || rows > 32 || width < 1 || width > 32 || frames < 1)
+    {
+        return false;
+    }
+
+    const uint8_t maskBytes = (rows + 7) / 8;
+    uint8_t offset = SPRITE_UPLOAD_HEADER;
+    for (uint8_t f = 0; f < frames; f++)
+    {
+        if (length - offset < 1 + maskBytes)
+        {
+            return false;
+        }
+        offset++; // duration
+        uint32_t rowMask = 0;
+        for (uint8_t b = 0; b < maskBytes; b++)
+        {
+            rowMask |= (uint32_t)spriteUploadByte(offset++) << (8 * b);
+        }
+        if (rows < 32 && rowMask >> rows)
+        {
+            return false; // rows past the sprite
+        }
+
+        uint8_t changed = 0;
+        for (; rowMask; rowMask &= rowMask - 1)
+        {
+            changed++;
+        }
+        if (length - offset < changed * ((width + 7) / 8))
+        {
+            return false;
+        }
+        offset += changed * ((width + 7) / 8);
+    }
+    return offset == length;
+}
+
+// takes size bytes of EEPROM from address for uploads and picks up the upload saved there, if any
+void spriteUploadInit(uint16_t address, uint8_t size)
+{
+    spriteUploadAddress = address;
+    spriteUploadSize = size - 1;
+    spriteUploadLength = EEPROM.read(address);
+    spriteUploadValid = spriteUploadCheck(spriteUploadLength);
+    if (!spriteUploadValid)
+    {
+        spriteUploadLength = 0;
+    }
+}
+
+// starts a new upload, the old one is dropped and a player showing it goes blank
+void spriteUploadBegin()
+{
+    EEPROM.update(spriteUploadAddress, SPRITE_UPLOAD_NONE);
+    spriteUploadValid = false;
+    spriteUploadLength = 0;
+    if (spriteAnimCurrent.eeprom && spriteAnimCurrent.frames != 0)
+    {
+        spriteAnimSelectUploaded();
+    }
+}
+
+// adds the next byte of the upload, false if it does not fit
+bool spriteUploadWrite(uint8_t value)
+{
+    if (spriteUploadValid || spriteUploadLength >= spriteUploadSize)
+    {
+        return false;
+    }
+    EEPROM.update(spriteUploadAddress + 1 + spriteUploadLength++, value);
+    return true;
+}
+
+// checks the upload and keeps it, starting to play it if it is selected, false if it is not valid
+bool spriteUploadEnd()
+{
+    if (spriteUploadValid || !spriteUploadCheck(spriteUploadLength))
+    {
+        return false;
+    }
+
+    EEPROM.update(spriteUploadAddress, spriteUploadLength);
+    spriteUploadValid = true;
+    if (spriteAnimCurrent.eeprom)
+    {
+        spriteAnimSelectUploaded();
+    }
+    return true;
+}
+
+// byte offset of the animation playing, from flash or the upload in EEPROM
+inline uint8_t spriteAnimByte(uint16_t offset)
+{
+    return spriteAnimCurrent.eeprom ? spriteUploadByte(SPRITE_UPLOAD_HEADER + offset)
+                                    : pgm_read_byte(spriteAnimCurrent.data + offset);
+}
+
+// decodes the next frame over the last one once the frame on display has had its time, returns true if it drew
+bool spriteAnim(unsigned long now)
+{
+    if (spriteAnimCurrent.data == nullptr && !spriteAnimCurrent.eeprom)
+    {
+        spriteAnimSelect(0);
+    }
+    if (spriteAnimCurrent.frames == 0)
+    {
+        // nothing uploaded, blank once rather than leave the last frame up
+        if (!spriteAnimStale)
+        {
+            return false;
+        }
+        spriteAnimStale = false;
+        scanClear();
+        scanShow();
+        return true;
+    }
+    if (spriteAnimStale)
+    {
+        spriteAnimFrame = 0;
+        spriteAnimStale = false;
+    }
+    else if ((uint16_t)(now - spriteAnimFrameStart) < spriteAnimDuration)
+    {
+        return false;
+    }
+
+    const SpriteAnimation &anim = spriteAnimCurrent;
+    const uint8_t rowBytes = (anim.width + 7) / 8;
+    // negative when the sprite is bigger than the panel, which then shows its middle
+    const int8_t x = ((int8_t)NUM_COLS - (int8_t)anim.width) / 2;
+    const int8_t y = ((int8_t)NUM_ROWS - (int8_t)anim.rows) / 2;
+
+    // the first frame is stored against a blank one, the rest against the frame before
+    if (spriteAnimFrame == 0)
+    {
+        spriteAnimOffset = 0;
+        scanClear();
+    }
+    else
+    {
+        scanRetain();
+    }
+
+    uint16_t offset = spriteAnimOffset;
+    spriteAnimDuration = spriteAnimByte(offset++) * 10;
+    uint32_t rowMask = 0;
+    for (uint8_t b = 0; b < (anim.rows + 7) / 8; b++)
+    {
+        rowMask |= (uint32_t)spriteAnimByte(offset++) << (8 * b);
+    }
+
+    for (uint8_t row = 0; row < anim.rows; row++)
+    {
+        if (rowMask & ((uint32_t)1 << row))
+        {
+            uint32_t bits = 0;
+            for (uint8_t b = 0; b < rowBytes; b++)
+            {
+                bits |= (uint32_t)spriteAnimByte(offset++) << (8 * b);
+            }
+            const int8_t panelRow = y + row;
+            if (panelRow >= 0 && panelRow < NUM_ROWS)
+            {
+                scanSetRow(panelRow, (rowdata_t)(x >= 0 ? bits << x : bits >> -x));
+            }
+        }
+    }
+    scanShow();
+
+    spriteAnimOffset = offset;
+    spriteAnimFrame = (spriteAnimFrame + 1) % anim.frames;
+    spriteAnimFrameStart = now;
+    return true;
+}
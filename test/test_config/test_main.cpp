@@ -0,0 +1,206 @@
+// Saves settings through the EEPROM stub and checks they load back, go round the slots and survive a save cut short,
+// message and all.
+//
+//   pio test -e native_8x8
+
+#include <unity.h>
+
+#include "../../savedConfig.h"
+
+static SavedConfig makeConfig(uint8_t mode)
+{
+  SavedConfig config = {};
+  config.updateInterval = 120;
+  config.flags = CONFIG_DISPLAY;
+  config.mode = mode;
+  config.animation = 2;
+  config.brightness = 85;
+  return config;
+}
+
+// runs a whole save, returns the EEPROM bytes it wrote
+static unsigned long save(const SavedConfig &config, const char *message)
+{
+  unsigned long writes = stub::eepromWrites;
+  configSaveBegin(config, message);
+  while (configSaveBusy())
+  {
+    configSaveStep();
+  }
+  return stub::eepromWrites - writes;
+}
+
+static void checkLoad(uint8_t mode, const char *message)
+{
+  SavedConfig loaded;
+  char saved[CONFIG_MESSAGE_SIZE];
+  TEST_ASSERT_TRUE(configLoad(loaded, saved));
+  TEST_ASSERT_EQUAL(mode, loaded.mode);
+  TEST_ASSERT_EQUAL(CONFIG_DISPLAY, loaded.flags & CONFIG_DISPLAY);
+  TEST_ASSERT_EQUAL(120, loaded.updateInterval);
+  TEST_ASSERT_EQUAL(85, loaded.brightness);
+  TEST_ASSERT_EQUAL_STRING(message, saved);
+}
+
+static void test_blank()
+{
+  SavedConfig loaded;
+  char saved[CONFIG_MESSAGE_SIZE];
+  TEST_ASSERT_FALSE(configLoad(loaded, saved));
+}
+
+static void test_save_load()
+{
+  save(makeConfig(1), "hello");
+  checkLoad(1, "hello");
+}
+
+// every save moves to the next slot, and once round only writes the bytes that changed
+static void test_ring()
+{
+  for (uint8_t i = 0; i < 3 * CONFIG_SLOTS; i++)
+  {
+    unsigned long writes = save(makeConfig(i), "hello");
+    if (i >= CONFIG_SLOTS)
+    {
+      TEST_ASSERT_LESS_OR_EQUAL(3, writes); // sequence, mode and check at most
+    }
+    TEST_ASSERT_EQUAL(i % CONFIG_SLOTS, configSlot);
+    checkLoad(i, "hello");
+  }
+}
+
+// a save stopped before its check byte leaves the one before it
+static void test_torn_save()
+{
+  save(makeConfig(1), "hello");
+  configSaveBegin(makeConfig(2), "hello");
+  while (configSaveIndex >= 0 && configSaveIndex < CONFIG_MESSAGE_SIZE + CONFIG_SLOT_SIZE - 1)
+  {
+    configSaveStep();
+  }
+  configSaveIndex = -1;
+  checkLoad(1, "hello");
+}
+
+// a save of a new message cut short anywhere leaves the old settings with the old message or the new ones with the
+// new message, never one with the other
+static void test_torn_message()
+{
+  for (unsigned long steps = 0;; steps++)
+  {
+    setUp();
+    save(makeConfig(1), "hello");
+    stub::nowMillis += CONFIG_MESSAGE_INTERVAL;
+    save(makeConfig(2), "first message");
+    stub::nowMillis += CONFIG_MESSAGE_INTERVAL;
+
+    configSaveBegin(makeConfig(3), "second, longer message");
+    for (unsigned long i = 0; i < steps && configSaveBusy(); i++)
+    {
+      configSaveStep();
+    }
+    bool done = !configSaveBusy();
+    configSaveIndex = -1; // power lost
+
+    SavedConfig loaded;
+    char saved[CONFIG_MESSAGE_SIZE];
+    TEST_ASSERT_TRUE(configLoad(loaded, saved));
+    if (loaded.mode == 3)
+    {
+      checkLoad(3, "second, longer message");
+    }
+    else
+    {
+      TEST_ASSERT_FALSE(done);
+      checkLoad(2, "first message");
+    }
+    if (done)
+    {
+      break;
+    }
+  }
+}
+
+// nothing is written when nothing changed
+static void test_unchanged()
+{
+  save(makeConfig(1), "hello");
+  TEST_ASSERT_EQUAL(0, save(makeConfig(1), "hello"));
+  TEST_ASSERT_EQUAL(0, configSlot);
+}
+
+// the message is saved at most once per CONFIG_MESSAGE_INTERVAL, the settings go on saving meanwhile
+static void test_message_interval()
+{
+  save(makeConfig(1), "hello");
+  save(makeConfig(2), "world");
+  checkLoad(2, "hello");
+  TEST_ASSERT_TRUE(configDirty);
+
+  stub::nowMillis += CONFIG_MESSAGE_INTERVAL;
+  save(makeConfig(2), "world");
+  checkLoad(2, "world");
+  TEST_ASSERT_FALSE(configDirty);
+}
+
+static void test_long_message()
+{
+  char message[2 * CONFIG_MESSAGE_SIZE];
+  memset(message, 'x', sizeof(message) - 1);
+  message[sizeof(message) - 1] = '\0';
+  save(makeConfig(1), message);
+
+  message[CONFIG_MESSAGE_SIZE - 1] = '\0';
+  checkLoad(1, message);
+}
+
+// saves wait for changes to settle, however many there are
+static void test_batching()
+{
+  configDirty = false;
+  for (uint8_t i = 0; i < 100; i++)
+  {
+    configChanged();
+    stub::nowMillis += 100;
+    TEST_ASSERT_FALSE(configSaveDue());
+  }
+  stub::nowMillis += CONFIG_SAVE_DELAY;
+  TEST_ASSERT_TRUE(configSaveDue());
+  configSaveBegin(makeConfig(1), "hello");
+  TEST_ASSERT_FALSE(configSaveDue());
+
+  // but not forever
+  for (unsigned long t = 0; t < CONFIG_SAVE_MAX_DELAY; t += 1000)
+  {
+    configChanged();
+    stub::nowMillis += 1000;
+  }
+  TEST_ASSERT_TRUE(configSaveDue());
+}
+
+void setUp()
+{
+  EEPROM.clear();
+  configSlot = CONFIG_SLOTS - 1;
+  configSaveIndex = -1;
+  configDirty = false;
+  configMessageSaved = false;
+}
+
+void tearDown() {}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_blank);
+  RUN_TEST(test_save_load);
+  RUN_TEST(test_ring);
+  RUN_TEST(test_torn_save);
+  RUN_TEST(test_torn_message);
+  RUN_TEST(test_unchanged);
+  RUN_TEST(test_message_interval);
+  RUN_TEST(test_long_message);
+  RUN_TEST(test_batching);
+  return UNITY_END();
+}
@@ -0,0 +1,230 @@
+// Checks the compile-time packed fonts against the Adafruit GFX tables they are built from, bit for bit, and the
+// glyph columns and text rows the scrollers are built on.
+//
+//   pio test -e native_8x8
+//   pio test -e native_16x16
+
+#include <unity.h>
+
+#include "../../scrollText.h"
+#include "../../Font4x5Fixed.h"
+#include "../../Font4x7Fixed.h"
+#include "../../Font5x7FixedMono.h"
+#include "../../Picopixel.h"
+#include "../../TomThumb.h"
+
+// pixel (x, y) from the cursor and baseline, read the way Adafruit_GFX::drawChar() does
+static bool gfxPixel(const GFXfont &font, unsigned char c, int16_t x, int16_t y)
+{
+  if (c < font.first || c > font.last)
+  {
+    return false;
+  }
+
+  const GFXglyph &glyph = font.glyph[c - font.first];
+  int16_t xx = x - glyph.xOffset;
+  int16_t yy = y - glyph.yOffset;
+  if (xx < 0 || xx >= glyph.width || yy < 0 || yy >= glyph.height)
+  {
+    return false;
+  }
+
+  uint16_t bit = yy * glyph.width + xx;
+  return font.bitmap[glyph.bitmapOffset + (bit >> 3)] & (0x80 >> (bit & 7));
+}
+
+template <typename Packed>
+static void checkPackedFont(const GFXfont &font, const Packed &packed)
+{
+  TEST_ASSERT_EQUAL_UINT8(font.yAdvance, Packed::yAdvance);
+
+  for (uint16_t c = 0; c < 256; c++)
+  {
+    uint8_t xAdvance = (c >= font.first && c <= font.last) ? font.glyph[c - font.first].xAdvance : 0;
+    TEST_ASSERT_EQUAL_UINT8_MESSAGE(xAdvance, packedCharWidth(packed, c), "xAdvance");
+
+    // every GFX pixel has to land in the cell, so scan a margin around it too
+    for (int16_t x = Packed::left - 8; x < Packed::left + Packed::width + 8; x++)
+    {
+      for (int16_t y = Packed::top - 8; y < Packed::top + Packed::height + 8; y++)
+      {
+        uint8_t col = x - Packed::left;
+        uint8_t row = y - Packed::top;
+        bool packedBit = col < Packed::width && row < Packed::height && ((packedCharColumn(packed, c, col) >> row) & 1);
+        TEST_ASSERT_EQUAL_MESSAGE(gfxPixel(font, c, x, y), packedBit, "pixel");
+      }
+    }
+  }
+}
+
+#define TEST_PACKED_FONT(font)                                    \
+  static void test_packed_##font()                                \
+  {                                                               \
+    static constexpr PACKED_FONT(font) packed =                   \
+        packFont<PACKED_FONT(font)>(font);                        \
+    checkPackedFont(font, packed);                                \
+  }
+
+TEST_PACKED_FONT(Font4x5Fixed)
+TEST_PACKED_FONT(Font4x7Fixed)
+TEST_PACKED_FONT(Font5x7FixedMono)
+TEST_PACKED_FONT(Picopixel)
+TEST_PACKED_FONT(TomThumb)
+
+// drawChar() with the panel font at every position that touches the frame
+static void test_draw_char()
+{
+  for (uint16_t c = FONT_SOURCE.first; c <= FONT_SOURCE.last; c++)
+  {
+    for (int16_t x = -8; x < NUM_COLS + 8; x++)
+    {
+      for (int16_t y = -8; y < NUM_ROWS + 8; y++)
+      {
+        scanClear();
+        uint8_t glyphWidth = 0;
+        drawChar(x, y, c, true, glyphWidth);
+        TEST_ASSERT_EQUAL_UINT8(FONT_SOURCE.glyph[c - FONT_SOURCE.first].xAdvance, glyphWidth);
+
+        for (uint8_t row = 0; row < NUM_ROWS; row++)
+        {
+          rowdata_t expected = 0;
+          for (uint8_t col = 0; col < NUM_COLS; col++)
+          {
+            if (gfxPixel(FONT_SOURCE, c, col - x, row - y))
+            {
+              expected |= (rowdata_t)1 << col;
+            }
+          }
+          TEST_ASSERT_EQUAL_HEX32(expected, Matrix::drawBuffer[0][row]);
+        }
+      }
+    }
+  }
+}
+
+// drawString() against plotting every GFX pixel of the string one at a time, at every position that touches the frame
+static void test_draw_string_pixels()
+{
+  const char *text = "Ag!, 0~";
+  const int16_t width = getTextWidth(text);
+  for (int16_t x = -width - 2; x < NUM_COLS + 2; x++)
+  {
+    for (int16_t y = -8; y < NUM_ROWS + 8; y++)
+    {
+      scanClear();
+      int16_t cursor = x;
+      for (const char *c = text; *c; c++)
+      {
+        for (int16_t row = 0; row < NUM_ROWS; row++)
+        {
+          for (int16_t col = 0; col < NUM_COLS; col++)
+          {
+            if (gfxPixel(FONT_SOURCE, *c, col - cursor, row - y))
+            {
+              scanSetPixel(col, row, true);
+            }
+          }
+        }
+        cursor += getCharWidth(*c);
+      }
+      rowdata_t expected[NUM_ROWS];
+      memcpy(expected, Matrix::drawBuffer[0], sizeof(expected));
+
+      scanClear();
+      drawString(x, y, MATRIX_WIDTH, MATRIX_HEIGHT, text, true);
+      for (uint8_t row = 0; row < NUM_ROWS; row++)
+      {
+        TEST_ASSERT_EQUAL_HEX32(expected[row], Matrix::drawBuffer[0][row]);
+      }
+    }
+  }
+}
+
+// the indexed drawString() skips to the sample at the left edge and draws what the plain one does, at every offset
+static void test_draw_string_indexed()
+{
+  char text[MAX_MESSAGE_SIZE];
+  for (uint8_t i = 0; i < MAX_MESSAGE_SIZE - 1; i++)
+  {
+    text[i] = ' ' + (i * 7) % 95;
+  }
+  text[MAX_MESSAGE_SIZE - 1] = '\0';
+
+  TextIndex index;
+  const int16_t width = buildTextIndex(text, index);
+  TEST_ASSERT_EQUAL(getTextWidth(text), width);
+
+  const int16_t y = MATRIX_HEIGHT - MESSAGE_Y_OFFSET;
+  for (int16_t x = -width - 2; x < NUM_COLS + 2; x++)
+  {
+    scanClear();
+    drawString(x, y, MATRIX_WIDTH, MATRIX_HEIGHT, text, true);
+    rowdata_t expected[NUM_ROWS];
+    memcpy(expected, Matrix::drawBuffer[0], sizeof(expected));
+
+    scanClear();
+    drawString(x, y, MATRIX_WIDTH, MATRIX_HEIGHT, text, true, index);
+    for (uint8_t row = 0; row < NUM_ROWS; row++)
+    {
+      TEST_ASSERT_EQUAL_HEX32(expected[row], Matrix::drawBuffer[0][row]);
+    }
+  }
+}
+
+// getCharColumn() feeds the scroller, columns across the advance at every baseline
+static void test_char_column()
+{
+  for (uint16_t c = FONT_SOURCE.first; c <= FONT_SOURCE.last; c++)
+  {
+    for (uint8_t col = 0; col < FONT_SOURCE.glyph[c - FONT_SOURCE.first].xAdvance; col++)
+    {
+      for (int16_t y = -8; y < NUM_ROWS + 8; y++)
+      {
+        uint32_t expected = 0;
+        for (uint8_t row = 0; row < NUM_ROWS; row++)
+        {
+          if (gfxPixel(FONT_SOURCE, c, col, row - y))
+          {
+            expected |= (uint32_t)1 << row;
+          }
+        }
+        TEST_ASSERT_EQUAL_HEX32(expected, getCharColumn(c, col, y));
+      }
+    }
+  }
+}
+
+// getTextRow() matches drawString() with the cell top on row 0
+static void test_text_row()
+{
+  const char *text = "Hi, 42 gjy!";
+  for (int16_t x = -(int16_t)getTextWidth(text); x < NUM_COLS + 2; x++)
+  {
+    scanClear();
+    drawString(x, -font_t::top, MATRIX_WIDTH, MATRIX_HEIGHT, text, true);
+    for (uint8_t row = 0; row < font_t::height; row++)
+    {
+      TEST_ASSERT_EQUAL_HEX32(Matrix::drawBuffer[0][row], getTextRow(text, strlen(text), x, row));
+    }
+  }
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_packed_Font4x5Fixed);
+  RUN_TEST(test_packed_Font4x7Fixed);
+  RUN_TEST(test_packed_Font5x7FixedMono);
+  RUN_TEST(test_packed_Picopixel);
+  RUN_TEST(test_packed_TomThumb);
+  RUN_TEST(test_draw_char);
+  RUN_TEST(test_draw_string_pixels);
+  RUN_TEST(test_draw_string_indexed);
+  RUN_TEST(test_char_column);
+  RUN_TEST(test_text_row);
+  return UNITY_END();
+}
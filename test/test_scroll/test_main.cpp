@@ -0,0 +1,192 @@
+// Runs the incremental text scrollers and checks every frame they show against the message drawn in full at the same
+// position, a drawString() redraw for the horizontal one and the word wrapped lines stacked up for the vertical one.
+//
+//   pio test -e native_8x8
+//   pio test -e native_16x16
+
+#include <unity.h>
+
+#include "../../scrollText.h"
+
+static const char *MESSAGE = "From a wild weird clime that lieth, sublime; out of Space, out of Time. 0123456789 !?";
+
+// the last frame shown against the message redrawn at x, the draw buffer is free between scroll steps
+static void checkFrame(int16_t x)
+{
+  const rowdata_t(*shown)[NUM_ROWS] = Matrix::frames[scanLastIndex()];
+  scanClear();
+  drawString(x, MATRIX_HEIGHT - MESSAGE_Y_OFFSET, MATRIX_WIDTH, MATRIX_HEIGHT, scrollMessage, true);
+  for (uint8_t p = 0; p < SCAN_BIT_DEPTH; p++)
+  {
+    for (uint8_t row = 0; row < NUM_ROWS; row++)
+    {
+      TEST_ASSERT_EQUAL_HEX32(Matrix::drawBuffer[p][row], shown[p][row]);
+    }
+  }
+}
+
+// a column at a time over three scroll cycles, the first frame a full redraw and the rest shifted and fed
+static void test_column_feeder()
+{
+  scrollTextSetMessage(MESSAGE);
+  const uint16_t cycle = scrollMessageWidth + MATRIX_WIDTH + 1;
+  for (uint16_t i = 0; i < 3 * cycle; i++)
+  {
+    int16_t x = scrollMessageX;
+    scrollText();
+    checkFrame(x);
+  }
+}
+
+// uneven steps, as vsync pacing gives at high speeds, land on the same frames as single steps
+static void test_multi_step()
+{
+  scrollTextSetMessage(MESSAGE);
+  const uint16_t cycle = scrollMessageWidth + MATRIX_WIDTH + 1;
+  uint32_t seed = 12345;
+  for (uint16_t i = 0; i < 3 * cycle;)
+  {
+    seed = seed * 1103515245 + 12345;
+    uint8_t steps = 1 + (seed >> 16) % 5;
+
+    // the frame shown is the one at the position of the last step
+    int16_t x = scrollMessageX;
+    for (uint8_t s = 1; s < steps; s++)
+    {
+      if (--x < -scrollMessageWidth)
+      {
+        x = MATRIX_WIDTH;
+      }
+    }
+    scrollText(steps);
+    checkFrame(x);
+    i += steps;
+  }
+}
+
+// message index of wrapped line n, the end of the message past its last line
+static uint8_t lineStart(const char *text, uint16_t n)
+{
+  uint8_t start = 0;
+  for (uint16_t line = 0; line < n && text[start]; line++)
+  {
+    uint16_t width;
+    start += wrapTextLine(text + start, MATRIX_WIDTH, width);
+    while (text[start] == ' ')
+      start++;
+    if (text[start] == '|')
+      start++;
+    while (text[start] == ' ')
+      start++;
+  }
+  return start;
+}
+
+// every line fits, breaks between words where it can and keeps no spaces at its ends
+static void test_wrap()
+{
+  const char *text = "a quick brown fox|jumps over  the extraordinarily lazy dog ";
+  for (uint8_t n = 0; text[lineStart(text, n)]; n++)
+  {
+    uint8_t start = lineStart(text, n);
+    uint16_t width;
+    uint8_t length = wrapTextLine(text + start, MATRIX_WIDTH, width);
+    char line[64] = {};
+    memcpy(line, text + start, length);
+    TEST_ASSERT_EQUAL(getTextWidth(line), width);
+    TEST_ASSERT_TRUE(width <= MATRIX_WIDTH || length == 1);
+    TEST_ASSERT_TRUE(length == 0 || (line[0] != ' ' && line[length - 1] != ' '));
+
+    // a word only goes onto the next line if it did not fit
+    char next = text[start + length];
+    if (next && next != ' ' && next != '|' && line[length - 1] != ' ')
+    {
+      TEST_ASSERT_TRUE(strchr(line, ' ') == nullptr);
+    }
+  }
+}
+
+// row t of the wrapped message stacked SCROLL_LINE_PITCH rows a line, blank past its last line
+static rowdata_t tapeRow(const char *text, uint16_t t)
+{
+  uint8_t start = lineStart(text, t / SCROLL_LINE_PITCH);
+  uint16_t width;
+  uint8_t length = wrapTextLine(text + start, MATRIX_WIDTH, width);
+  uint8_t glyphRow = t % SCROLL_LINE_PITCH - SCROLL_LINE_TOP;
+  if (glyphRow >= font_t::height)
+  {
+    return 0;
+  }
+  return getTextRow(text + start, length, (MATRIX_WIDTH - (int16_t)width) / 2, glyphRow);
+}
+
+static const rowdata_t *shownFrame()
+{
+  return Matrix::frames[scanLastIndex()][0];
+}
+
+// a whole cycle a row at a time, then again in uneven steps landing on the same frames
+static void test_scroll_vertical()
+{
+  const char *text = "Line one|and a much longer second line";
+  uint16_t lines = 0;
+  while (text[lineStart(text, lines)])
+  {
+    lines++;
+  }
+  const uint16_t cycle = (lines + SCROLL_LINES) * SCROLL_LINE_PITCH;
+
+  for (uint8_t stride = 1; stride <= 3; stride++)
+  {
+    scrollTextSetMessage(text);
+    scrollTextVertical(1, false); // starts blank
+    for (uint16_t t = stride; t <= 2 * cycle; t += stride)
+    {
+      scrollTextVertical(stride, false);
+      for (uint8_t row = 0; row < NUM_ROWS; row++)
+      {
+        int16_t tape = (int16_t)(t % cycle) - NUM_ROWS + row;
+        rowdata_t expected = tape >= 0 ? tapeRow(text, tape) : 0; // blank lines from the cycle before
+        TEST_ASSERT_EQUAL_HEX32(expected, shownFrame()[row]);
+      }
+    }
+  }
+}
+
+// a paged scroll stops with each line all in
+static void test_scroll_paged()
+{
+  scrollTextSetMessage("one|two|three");
+  scrollTextVertical(1, true);
+  for (uint8_t line = 0; line < 3; line++)
+  {
+    for (uint8_t row = 0; row < SCROLL_LINE_PITCH; row++)
+    {
+      scrollTextVertical(1, true);
+    }
+    rowdata_t held[NUM_ROWS];
+    memcpy(held, shownFrame(), sizeof(held));
+    for (uint8_t step = 0; step < SCROLL_PAGE_HOLD; step++)
+    {
+      scrollTextVertical(1, true);
+      TEST_ASSERT_EQUAL(0, memcmp(held, shownFrame(), sizeof(held)));
+    }
+    TEST_ASSERT_EQUAL_HEX32(tapeRow("one|two|three", line * SCROLL_LINE_PITCH + SCROLL_LINE_TOP + 1),
+                            held[NUM_ROWS - SCROLL_LINE_PITCH + SCROLL_LINE_TOP + 1]);
+  }
+}
+
+void setUp() {}
+
+void tearDown() {}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_column_feeder);
+  RUN_TEST(test_multi_step);
+  RUN_TEST(test_wrap);
+  RUN_TEST(test_scroll_vertical);
+  RUN_TEST(test_scroll_paged);
+  return UNITY_END();
+}
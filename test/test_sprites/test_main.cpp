@@ -0,0 +1,236 @@
+// Plays the packed sprite animations, built in and uploaded, through spriteAnim() and checks every frame drawn against
+// the source frames.
+//
+//   pio test -e native_8x8
+//   pio test -e native_16x16
+
+#include <unity.h>
+
+#include "../../savedConfig.h"
+#include "../../spriteAnim.h"
+
+// plays the selected animation, centered and cut to the panel when bigger than it
+template <uint8_t Rows, size_t Frames>
+static void checkSprite(const SpriteFrame<Rows> (&frames)[Frames])
+{
+  const int width = spriteWidth(frames);
+  const int x = (NUM_COLS - width) / 2;
+  const int y = (NUM_ROWS - (int)Rows) / 2;
+
+  unsigned long now = 0;
+
+  // twice round to cover the wrap back to the first frame
+  for (size_t i = 0; i < 2 * Frames; i++)
+  {
+    const SpriteFrame<Rows> &frame = frames[i % Frames];
+    TEST_ASSERT_TRUE(spriteAnim(now));
+    TEST_ASSERT_FALSE(spriteAnim(now + (frame.duration + 5) / 10 * 10 - 1));
+
+    const rowdata_t *shown = Matrix::frames[scanLastIndex()][0];
+    for (int row = 0; row < NUM_ROWS; row++)
+    {
+      rowdata_t expected = 0;
+      for (int col = 0; col < NUM_COLS; col++)
+      {
+        if (row - y >= 0 && row - y < Rows && col - x >= 0 && col - x < width && frame.rows[row - y][col - x] == '#')
+        {
+          expected |= (rowdata_t)1 << col;
+        }
+      }
+      TEST_ASSERT_EQUAL_HEX32(expected, shown[row]);
+    }
+    now += (frame.duration + 5) / 10 * 10;
+  }
+}
+
+static void test_heart()
+{
+  spriteAnimSelect(0);
+  checkSprite(heartFrames);
+}
+
+static void test_pacman()
+{
+  spriteAnimSelect(1);
+  checkSprite(pacmanFrames);
+}
+
+static void test_invader()
+{
+  spriteAnimSelect(2);
+  checkSprite(invaderFrames);
+}
+
+// only changed rows are stored after the first frame
+static void test_packed_size()
+{
+  TEST_ASSERT_EQUAL(2 * 2 + 7 + 7, sizeof(HEART_SPRITE));
+  TEST_ASSERT_EQUAL(2 * 2 + 8 + 4, sizeof(PACMAN_SPRITE));
+}
+
+// true if every row of the last frame shown is blank
+static bool frameBlank()
+{
+  const rowdata_t *shown = Matrix::frames[scanLastIndex()][0];
+  for (uint8_t row = 0; row < NUM_ROWS; row++)
+  {
+    if (shown[row])
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <typename Packed>
+static bool upload(const Packed &packed)
+{
+  spriteUploadBegin();
+  const uint8_t header[] = {Packed::rows, Packed::width, Packed::frames};
+  for (uint8_t value : header)
+  {
+    spriteUploadWrite(value);
+  }
+  for (uint8_t value : packed.data)
+  {
+    if (!spriteUploadWrite(value))
+    {
+      return false;
+    }
+  }
+  return spriteUploadEnd();
+}
+
+// what the firmware does at boot
+static void restart()
+{
+  spriteUploadInit(CONFIG_UPLOAD_ADDRESS, CONFIG_UPLOAD_SIZE);
+  spriteAnimSelectUploaded();
+}
+
+static void test_upload()
+{
+  spriteAnimSelect(0);
+  checkSprite(heartFrames);
+
+  // nothing uploaded yet, the heart is cleared once instead of left up
+  spriteAnimSelectUploaded();
+  TEST_ASSERT_TRUE(spriteAnim(0));
+  TEST_ASSERT_TRUE(frameBlank());
+  TEST_ASSERT_FALSE(spriteAnim(1000));
+
+  TEST_ASSERT_TRUE(upload(HEART_SPRITE));
+  checkSprite(heartFrames);
+
+  // a new upload replaces the one playing
+  TEST_ASSERT_TRUE(upload(INVADER_SPRITE));
+  checkSprite(invaderFrames);
+
+  // and plays again after a power cycle
+  restart();
+  checkSprite(invaderFrames);
+
+  // one begun and never ended drops it, before and after a power cycle
+  spriteUploadBegin();
+  TEST_ASSERT_TRUE(spriteAnim(0));
+  TEST_ASSERT_TRUE(frameBlank());
+  TEST_ASSERT_TRUE(spriteUploadWrite(8));
+  restart();
+  TEST_ASSERT_TRUE(spriteAnim(0));
+  TEST_ASSERT_TRUE(frameBlank());
+  TEST_ASSERT_FALSE(spriteAnim(1000));
+}
+
+// a frame lighting the whole panel fits the upload area
+static void test_upload_full_frame()
+{
+  const uint8_t rowBytes = (NUM_COLS + 7) / 8;
+  const uint8_t maskBytes = (NUM_ROWS + 7) / 8;
+  spriteUploadBegin();
+  const uint8_t header[] = {NUM_ROWS, NUM_COLS, 1, 50};
+  for (uint8_t value : header)
+  {
+    TEST_ASSERT_TRUE(spriteUploadWrite(value));
+  }
+  for (uint8_t b = 0; b < maskBytes; b++)
+  {
+    TEST_ASSERT_TRUE(spriteUploadWrite(NUM_ROWS - 8 * b >= 8 ? 0xFF : (1 << (NUM_ROWS - 8 * b)) - 1));
+  }
+  for (uint16_t i = 0; i < NUM_ROWS * rowBytes; i++)
+  {
+    TEST_ASSERT_TRUE(spriteUploadWrite(0xFF));
+  }
+  TEST_ASSERT_TRUE(spriteUploadEnd());
+
+  spriteAnimSelectUploaded();
+  TEST_ASSERT_TRUE(spriteAnim(0));
+  const rowdata_t *shown = Matrix::frames[scanLastIndex()][0];
+  for (uint8_t row = 0; row < NUM_ROWS; row++)
+  {
+    TEST_ASSERT_EQUAL((rowdata_t)~(rowdata_t)0 >> (8 * sizeof(rowdata_t) - NUM_COLS), shown[row]);
+  }
+}
+
+// uploads that do not hold exactly the frames their header gives are dropped and play nothing
+static void test_upload_rejected()
+{
+  spriteAnimSelectUploaded();
+
+  spriteUploadBegin();
+  const uint8_t shortFrame[] = {8, 8, 1, 50, 0x03, 0xFF};
+  for (uint8_t value : shortFrame)
+  {
+    spriteUploadWrite(value);
+  }
+  TEST_ASSERT_FALSE(spriteUploadEnd());
+  TEST_ASSERT_TRUE(spriteAnim(0));
+  TEST_ASSERT_TRUE(frameBlank());
+  TEST_ASSERT_FALSE(spriteAnim(1000));
+
+  spriteUploadBegin();
+  const uint8_t rowPastSprite[] = {4, 8, 1, 50, 0x10, 0xFF};
+  for (uint8_t value : rowPastSprite)
+  {
+    spriteUploadWrite(value);
+  }
+  TEST_ASSERT_FALSE(spriteUploadEnd());
+
+  spriteUploadBegin();
+  const uint8_t trailing[] = {8, 8, 1, 50, 0x01, 0xFF, 0x00};
+  for (uint8_t value : trailing)
+  {
+    spriteUploadWrite(value);
+  }
+  TEST_ASSERT_FALSE(spriteUploadEnd());
+
+  // the area's first byte is the upload's length, the rest takes the upload
+  spriteUploadBegin();
+  for (uint16_t i = 0; i < CONFIG_UPLOAD_SIZE - 1; i++)
+  {
+    TEST_ASSERT_TRUE(spriteUploadWrite(0));
+  }
+  TEST_ASSERT_FALSE(spriteUploadWrite(0));
+  TEST_ASSERT_FALSE(spriteUploadEnd());
+  TEST_ASSERT_FALSE(spriteAnim(0));
+}
+
+void setUp()
+{
+  EEPROM.clear();
+  spriteUploadInit(CONFIG_UPLOAD_ADDRESS, CONFIG_UPLOAD_SIZE);
+}
+
+void tearDown() {}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_heart);
+  RUN_TEST(test_pacman);
+  RUN_TEST(test_invader);
+  RUN_TEST(test_packed_size);
+  RUN_TEST(test_upload);
+  RUN_TEST(test_upload_full_frame);
+  RUN_TEST(test_upload_rejected);
+  return UNITY_END();
+}